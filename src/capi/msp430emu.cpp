@@ -0,0 +1,264 @@
+#include <memory>
+#include <new>
+#include <string.h>
+#include <vector>
+
+#include "MSP430.h"
+#include "msp430emu.h"
+
+namespace
+{
+
+// Peripheral calling back the embedding process
+class CApiPeripheral : public Peripheral
+{
+public:
+    CApiPeripheral(msp430emu_rx_cb rx, msp430emu_tx_cb tx, void *context)
+        : rx_(rx), tx_(tx), context_(context)
+    {
+    }
+
+    void txCb(uint8_t value) override { tx_(context_, value); }
+    uint8_t rxCb() override { return rx_(context_); }
+
+private:
+    msp430emu_rx_cb rx_;
+    msp430emu_tx_cb tx_;
+    void *context_;
+};
+
+} // namespace
+
+struct msp430emu
+{
+    MSP430 cpu;
+    std::vector<std::unique_ptr<CApiPeripheral>> peripherals;
+    // Reused by snapshots, so that saving one does not allocate
+    std::vector<uint8_t> snapshot;
+};
+
+static constexpr unsigned NB_PORTS = 8;
+
+int msp430emu_abi_version(void) { return MSP430EMU_ABI_VERSION; }
+
+msp430emu *msp430emu_create(void) { return new (std::nothrow) msp430emu(); }
+
+void msp430emu_destroy(msp430emu *emu) { delete emu; }
+
+int msp430emu_load_image(msp430emu *emu, const uint8_t *data, size_t size,
+                         uint32_t address, uint32_t entry)
+{
+    if (!emu || !data || !DevicesManager::isValidRange(address, size))
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+    if (!emu->cpu.loadImage(data, size, address))
+    {
+        return MSP430EMU_ERROR_FAILED;
+    }
+    emu->cpu.setPc(entry);
+    return MSP430EMU_OK;
+}
+
+int msp430emu_set_jit(msp430emu *emu, int enabled)
+{
+    if (!emu)
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+
+    MSP430::EXECUTION_BACKEND backend =
+        enabled ? MSP430::BACKEND_JIT : MSP430::BACKEND_INTERPRETER;
+    return emu->cpu.setExecutionBackend(backend) ? MSP430EMU_OK
+                                                 : MSP430EMU_ERROR_FAILED;
+}
+
+// Relative budget to absolute limit, saturating
+static uint64_t limitAfter(uint64_t now, uint64_t budget)
+{
+    return (budget > MSP430::NO_LIMIT - now) ? MSP430::NO_LIMIT : now + budget;
+}
+
+int msp430emu_run(msp430emu *emu, uint64_t cycles, uint64_t instructions,
+                  uint32_t target_pc)
+{
+    if (!emu)
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+
+    MSP430 &cpu = emu->cpu;
+    MSP430::STOP_REASON reason = cpu.runBounded(
+        {limitAfter(cpu.getCycles(), cycles),
+         limitAfter(cpu.getExecutedInstructions(), instructions), target_pc,
+         true});
+
+    switch (reason)
+    {
+    case MSP430::STOP_CYCLES:
+        return MSP430EMU_STOP_CYCLES;
+    case MSP430::STOP_INSTRUCTIONS:
+        return MSP430EMU_STOP_INSTRUCTIONS;
+    case MSP430::STOP_TARGET_PC:
+        return MSP430EMU_STOP_TARGET_PC;
+    case MSP430::STOP_BREAKPOINT:
+        return MSP430EMU_STOP_BREAKPOINT;
+    case MSP430::STOP_WATCHPOINT:
+        return MSP430EMU_STOP_WATCHPOINT;
+    case MSP430::STOP_HALT:
+        return MSP430EMU_STOP_HALT;
+    default:
+        return MSP430EMU_STOP_REQUESTED;
+    }
+}
+
+void msp430emu_request_stop(msp430emu *emu)
+{
+    if (emu)
+    {
+        emu->cpu.requestStop();
+    }
+}
+
+int msp430emu_add_breakpoint(msp430emu *emu, uint32_t pc)
+{
+    if (!emu)
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+    emu->cpu.addBreakpoint(pc);
+    return MSP430EMU_OK;
+}
+
+int msp430emu_remove_breakpoint(msp430emu *emu, uint32_t pc)
+{
+    if (!emu)
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+    emu->cpu.removeBreakpoint(pc);
+    return MSP430EMU_OK;
+}
+
+uint64_t msp430emu_get_cycles(const msp430emu *emu)
+{
+    return emu ? emu->cpu.getCycles() : 0;
+}
+
+uint64_t msp430emu_get_instructions(const msp430emu *emu)
+{
+    return emu ? emu->cpu.getExecutedInstructions() : 0;
+}
+
+int msp430emu_read_register(msp430emu *emu, unsigned reg, uint32_t *value)
+{
+    if (!emu || !value || (reg >= MSP430::NB_REGISTERS))
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+    *value = emu->cpu.readRegister(reg);
+    return MSP430EMU_OK;
+}
+
+int msp430emu_write_register(msp430emu *emu, unsigned reg, uint32_t value)
+{
+    if (!emu || (reg >= MSP430::NB_REGISTERS))
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+    // Registers are 20 bits wide
+    emu->cpu.writeRegister(reg, value & 0xFFFFF);
+    return MSP430EMU_OK;
+}
+
+int msp430emu_read_memory(msp430emu *emu, uint32_t address, uint8_t *buffer,
+                          size_t size)
+{
+    if (!emu || (!buffer && size))
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+    return emu->cpu.getDevicesManager().debugRead(address, buffer, size)
+               ? MSP430EMU_OK
+               : MSP430EMU_ERROR_ARGUMENT;
+}
+
+int msp430emu_write_memory(msp430emu *emu, uint32_t address,
+                           const uint8_t *data, size_t size)
+{
+    if (!emu || (!data && size))
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+
+    DevicesManager &bus = emu->cpu.getDevicesManager();
+    if (!bus.debugWrite(address, data, size))
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+    bus.flushPinChanges();
+    return MSP430EMU_OK;
+}
+
+int msp430emu_register_peripheral(msp430emu *emu, unsigned port,
+                                  msp430emu_rx_cb rx, msp430emu_tx_cb tx,
+                                  void *context)
+{
+    if (!emu || (port < 1) || (port > NB_PORTS) || !rx || !tx)
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+
+    try
+    {
+        emu->peripherals.push_back(
+            std::make_unique<CApiPeripheral>(rx, tx, context));
+    }
+    catch (const std::bad_alloc &)
+    {
+        return MSP430EMU_ERROR_FAILED;
+    }
+    emu->cpu.getDevicesManager().attachPeripheral(
+        port, emu->peripherals.back().get());
+    return MSP430EMU_OK;
+}
+
+int msp430emu_save_snapshot(msp430emu *emu, uint8_t *buffer, size_t *size)
+{
+    if (!emu || !size)
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+
+    try
+    {
+        if (!emu->cpu.saveSnapshot(emu->snapshot))
+        {
+            return MSP430EMU_ERROR_FAILED;
+        }
+    }
+    catch (const std::bad_alloc &)
+    {
+        return MSP430EMU_ERROR_FAILED;
+    }
+
+    size_t capacity = *size;
+    *size = emu->snapshot.size();
+    if (!buffer || (capacity < emu->snapshot.size()))
+    {
+        return MSP430EMU_ERROR_BUFFER_SIZE;
+    }
+    memcpy(buffer, emu->snapshot.data(), emu->snapshot.size());
+    return MSP430EMU_OK;
+}
+
+int msp430emu_restore_snapshot(msp430emu *emu, const uint8_t *data,
+                               size_t size)
+{
+    if (!emu || !data)
+    {
+        return MSP430EMU_ERROR_ARGUMENT;
+    }
+    return emu->cpu.restoreSnapshot(data, size) ? MSP430EMU_OK
+                                                : MSP430EMU_ERROR_FAILED;
+}
@@ -0,0 +1,123 @@
+#ifndef MSP430EMU_H
+#define MSP430EMU_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * C interface of the MSP430F2618 emulator, for embedding it in other
+ * processes.
+ *
+ * Each emulator is an opaque handle, independent from the others: several
+ * can run concurrently on different threads, but one handle must only be
+ * used by one thread at a time (msp430emu_request_stop() excepted).
+ * Functions returning int return MSP430EMU_OK or a negative error code.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MSP430EMU_BUILD) && defined(__GNUC__)
+#define MSP430EMU_API __attribute__((visibility("default")))
+#else
+#define MSP430EMU_API
+#endif
+
+/* Incremented on incompatible changes of this interface */
+#define MSP430EMU_ABI_VERSION 1
+
+#define MSP430EMU_NO_LIMIT UINT64_MAX
+#define MSP430EMU_NO_TARGET_PC UINT32_MAX
+
+enum msp430emu_error
+{
+    MSP430EMU_OK = 0,
+    MSP430EMU_ERROR_ARGUMENT = -1,    /* invalid handle, register, port or
+                                         address */
+    MSP430EMU_ERROR_FAILED = -2,      /* operation refused by the machine */
+    MSP430EMU_ERROR_BUFFER_SIZE = -3, /* output buffer too small */
+};
+
+/* Why msp430emu_run() returned */
+enum msp430emu_stop_reason
+{
+    MSP430EMU_STOP_CYCLES = 1,       /* cycle budget spent */
+    MSP430EMU_STOP_INSTRUCTIONS = 2, /* instruction budget spent */
+    MSP430EMU_STOP_TARGET_PC = 3,    /* target address reached */
+    MSP430EMU_STOP_BREAKPOINT = 4,   /* breakpoint reached */
+    MSP430EMU_STOP_WATCHPOINT = 5,   /* watched address written */
+    MSP430EMU_STOP_HALT = 6,         /* CPU off with nothing to wake it */
+    MSP430EMU_STOP_REQUESTED = 7,    /* msp430emu_request_stop() called */
+};
+
+typedef struct msp430emu msp430emu;
+
+/* Peripheral connected to a port: rx returns the pins it drives, tx is
+ * called with the port output on each change. Changes are delivered in
+ * batches, before the firmware reads the port inputs, when a run returns
+ * and after msp430emu_write_memory(). */
+typedef uint8_t (*msp430emu_rx_cb)(void *context);
+typedef void (*msp430emu_tx_cb)(void *context, uint8_t value);
+
+MSP430EMU_API int msp430emu_abi_version(void);
+
+/* Returns NULL if the emulator cannot be allocated */
+MSP430EMU_API msp430emu *msp430emu_create(void);
+MSP430EMU_API void msp430emu_destroy(msp430emu *emu);
+
+/* Writes an image to the bus from address, and sets PC to entry */
+MSP430EMU_API int msp430emu_load_image(msp430emu *emu, const uint8_t *data,
+                                       size_t size, uint32_t address,
+                                       uint32_t entry);
+MSP430EMU_API int msp430emu_set_jit(msp430emu *emu, int enabled);
+
+/* Runs until one of the budgets, relative to the current counters, is
+ * spent or PC reaches target_pc. Returns a msp430emu_stop_reason. */
+MSP430EMU_API int msp430emu_run(msp430emu *emu, uint64_t cycles,
+                                uint64_t instructions, uint32_t target_pc);
+/* Makes the current run return; can be called from any thread */
+MSP430EMU_API void msp430emu_request_stop(msp430emu *emu);
+MSP430EMU_API int msp430emu_add_breakpoint(msp430emu *emu, uint32_t pc);
+MSP430EMU_API int msp430emu_remove_breakpoint(msp430emu *emu, uint32_t pc);
+
+MSP430EMU_API uint64_t msp430emu_get_cycles(const msp430emu *emu);
+MSP430EMU_API uint64_t msp430emu_get_instructions(const msp430emu *emu);
+
+MSP430EMU_API int msp430emu_read_register(msp430emu *emu, unsigned reg,
+                                          uint32_t *value);
+MSP430EMU_API int msp430emu_write_register(msp430emu *emu, unsigned reg,
+                                           uint32_t value);
+/* Memory accesses go through the bus, byte by byte. Word-only registers
+ * (e.g. the watchdog) can be read but not written this way. Nothing is
+ * accessed if a byte of the range is outside the bus or not writable. */
+MSP430EMU_API int msp430emu_read_memory(msp430emu *emu, uint32_t address,
+                                        uint8_t *buffer, size_t size);
+MSP430EMU_API int msp430emu_write_memory(msp430emu *emu, uint32_t address,
+                                         const uint8_t *data, size_t size);
+
+/* Connects a peripheral to port 1 to 8. context is passed back to the
+ * callbacks, which are called on the thread running the emulator. */
+MSP430EMU_API int msp430emu_register_peripheral(msp430emu *emu,
+                                                unsigned port,
+                                                msp430emu_rx_cb rx,
+                                                msp430emu_tx_cb tx,
+                                                void *context);
+
+/* Saves the machine state to buffer. *size gives the buffer capacity and
+ * is set to the snapshot size; if the buffer is too small,
+ * MSP430EMU_ERROR_BUFFER_SIZE is returned and nothing is written. */
+MSP430EMU_API int msp430emu_save_snapshot(msp430emu *emu, uint8_t *buffer,
+                                          size_t *size);
+/* Restores a snapshot taken by msp430emu_save_snapshot(). A truncated or
+ * corrupt snapshot is rejected with MSP430EMU_ERROR_FAILED before anything
+ * is restored. */
+MSP430EMU_API int msp430emu_restore_snapshot(msp430emu *emu,
+                                             const uint8_t *data,
+                                             size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MSP430EMU_H */
@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "MSP430.h"
+#include "MSP430Pacer.h"
+#include "Uart.h"
+
+// Headless front end: runs a ROM for a bounded time and dumps the final
+// state, for machines without a display
+
+// Cycles run between two pacing checks
+static constexpr uint64_t PACING_SLICE = 10000;
+
+struct MemoryRange
+{
+    uint32_t address;
+    uint32_t size;
+};
+
+struct Options
+{
+    std::string romFile;
+    uint64_t cycles = 1000000;
+    PACING_MODE pacing = PACING_MAX_SPEED;
+    double speed = 1.0;
+    uint64_t frequency = MSP430Pacer::DEFAULT_CPU_FREQUENCY;
+    MSP430::EXECUTION_BACKEND backend = MSP430::BACKEND_INTERPRETER;
+    std::vector<MemoryRange> dumps;
+    std::string recordFile;
+    std::string replayFile;
+};
+
+static void usage()
+{
+    std::cout
+        << "Usage: emulator-cli <rom_file> [options]\n"
+        << "  --cycles N          CPU cycles to run (default 1000000)\n"
+        << "  --pacing MODE       max (default), realtime or a speed factor\n"
+        << "  --frequency HZ      CPU frequency used by pacing\n"
+        << "  --backend NAME      interpreter (default) or jit\n"
+        << "  --dump ADDR:SIZE    dump a memory range at the end, repeatable\n"
+        << "  --record FILE       record the external inputs to FILE\n"
+        << "  --replay FILE       replay the external inputs from FILE, not\n"
+        << "                      with --record\n"
+        << "Numbers can be given in hexadecimal with a 0x prefix."
+        << std::endl;
+}
+
+static bool parseNumber(const std::string &str, uint64_t &value)
+{
+    char *end;
+
+    value = strtoull(str.c_str(), &end, 0);
+    return !str.empty() && (*end == '\0');
+}
+
+static bool parseRange(const std::string &str, MemoryRange &range)
+{
+    size_t colon = str.find(':');
+    uint64_t address;
+    uint64_t size;
+
+    if ((colon == std::string::npos) ||
+        !parseNumber(str.substr(0, colon), address) ||
+        !parseNumber(str.substr(colon + 1), size) || (address > UINT32_MAX) ||
+        !DevicesManager::isValidRange(address, size))
+    {
+        return false;
+    }
+    range.address = address;
+    range.size = size;
+    return true;
+}
+
+static bool parsePacing(const std::string &str, Options &options)
+{
+    if (str == "max")
+    {
+        options.pacing = PACING_MAX_SPEED;
+        return true;
+    }
+    if (str == "realtime")
+    {
+        options.pacing = PACING_REAL_TIME;
+        return true;
+    }
+
+    char *end;
+    options.speed = strtod(str.c_str(), &end);
+    options.pacing = PACING_SCALED;
+    return !str.empty() && (*end == '\0') && (options.speed > 0);
+}
+
+static bool parseOptions(int argc, char *argv[], Options &options)
+{
+    if (argc < 2)
+    {
+        return false;
+    }
+    options.romFile = argv[1];
+
+    for (int i = 2; i < argc; i++)
+    {
+        std::string option = argv[i];
+
+        if (i + 1 >= argc)
+        {
+            return false;
+        }
+        std::string value = argv[++i];
+        bool valid = true;
+
+        if (option == "--cycles")
+        {
+            valid = parseNumber(value, options.cycles);
+        }
+        else if (option == "--pacing")
+        {
+            valid = parsePacing(value, options);
+        }
+        else if (option == "--frequency")
+        {
+            valid = parseNumber(value, options.frequency) &&
+                    (options.frequency != 0);
+        }
+        else if (option == "--backend")
+        {
+            options.backend = (value == "jit") ? MSP430::BACKEND_JIT
+                                               : MSP430::BACKEND_INTERPRETER;
+            valid = (value == "jit") || (value == "interpreter");
+        }
+        else if (option == "--dump")
+        {
+            MemoryRange range;
+
+            valid = parseRange(value, range);
+            options.dumps.push_back(range);
+        }
+        else if (option == "--record")
+        {
+            options.recordFile = value;
+        }
+        else if (option == "--replay")
+        {
+            options.replayFile = value;
+        }
+        else
+        {
+            valid = false;
+        }
+
+        if (!valid)
+        {
+            return false;
+        }
+    }
+
+    // A replayed run records nothing, its log would be left empty
+    return options.recordFile.empty() || options.replayFile.empty();
+}
+
+static const char *stopReasonName(MSP430::STOP_REASON reason)
+{
+    switch (reason)
+    {
+    case MSP430::STOP_CYCLES:
+        return "cycles";
+    case MSP430::STOP_HALT:
+        return "halt";
+    case MSP430::STOP_REQUESTED:
+        return "requested";
+    default:
+        return "other";
+    }
+}
+
+// Runs cycles CPU cycles, in slices paced against the host clock unless
+// running at full speed
+static MSP430::STOP_REASON run(MSP430 &uC, const Options &options)
+{
+    MSP430Pacer pacer;
+    uint64_t end = uC.getCycles() + options.cycles;
+
+    if (options.pacing == PACING_MAX_SPEED)
+    {
+        return uC.runFor(options.cycles);
+    }
+
+    pacer.setMode(options.pacing, options.speed);
+    pacer.setCpuFrequency(options.frequency);
+    pacer.start(uC.getCycles());
+    while (uC.getCycles() < end)
+    {
+        MSP430::STOP_REASON reason =
+            uC.runFor(std::min(PACING_SLICE, end - uC.getCycles()));
+
+        if (reason != MSP430::STOP_CYCLES)
+        {
+            return reason;
+        }
+        pacer.pace(uC.getCycles());
+    }
+    return MSP430::STOP_CYCLES;
+}
+
+static void dumpState(MSP430 &uC, const Options &options,
+                      MSP430::STOP_REASON reason)
+{
+    DevicesManager &bus = uC.getDevicesManager();
+
+    std::cout << std::hex << std::uppercase << std::setfill('0');
+    std::cout << "stop: " << stopReasonName(reason) << "\n"
+              << "cycles: " << std::dec << uC.getCycles() << "\n"
+              << "instructions: " << uC.getExecutedInstructions()
+              << std::hex << "\n";
+
+    for (uint8_t reg = 0; reg < MSP430::NB_REGISTERS; reg++)
+    {
+        std::cout << "R" << std::dec << std::setw(2) << (int) reg << std::hex
+                  << " = " << std::setw(5) << uC.readRegister(reg)
+                  << (((reg % 4) == 3) ? "\n" : "  ");
+    }
+
+    for (const MemoryRange &range : options.dumps)
+    {
+        std::vector<uint8_t> data(range.size);
+
+        // Ranges were validated by parseRange(), this reads word-only
+        // registers without a byte access they would reject
+        bus.debugRead(range.address, data.data(), data.size());
+        for (uint32_t offset = 0; offset < range.size; offset++)
+        {
+            uint32_t address = range.address + offset;
+
+            if ((offset % 16) == 0)
+            {
+                std::cout << std::setw(5) << address << ":";
+            }
+            std::cout << " " << std::setw(2) << (int) data[offset];
+            if (((offset % 16) == 15) || (offset + 1 == range.size))
+            {
+                std::cout << "\n";
+            }
+        }
+    }
+    std::cout << std::flush;
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+
+    if (!parseOptions(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+
+    // Create the MSP430F2618 microcontroller
+    MSP430 uC;
+    Uart uart;
+    DevicesManager &dm = uC.getDevicesManager();
+    InputLog &inputs = dm.getInputLog();
+
+    dm.attachPeripheral(uart.port, &uart);
+
+    if (!uC.loadROM(options.romFile))
+    {
+        std::cerr << "Failed to load ROM" << std::endl;
+        return 1;
+    }
+    if (!uC.setExecutionBackend(options.backend))
+    {
+        std::cerr << "Execution backend not available" << std::endl;
+        return 1;
+    }
+
+    if (!options.replayFile.empty())
+    {
+        if (!inputs.replayFile(options.replayFile))
+        {
+            std::cerr << "Failed to load input log" << std::endl;
+            return 1;
+        }
+    }
+    else if (!options.recordFile.empty())
+    {
+        inputs.startRecording();
+    }
+
+    MSP430::STOP_REASON reason = run(uC, options);
+
+    if (!options.recordFile.empty() && !inputs.saveLog(options.recordFile))
+    {
+        std::cerr << "Failed to save input log" << std::endl;
+        return 1;
+    }
+
+    dumpState(uC, options, reason);
+    return 0;
+}
@@ -6,6 +6,10 @@
 #include <string>
 #include <vector>
 
+#include "EventScheduler.h"
+#include "InterruptController.h"
+#include "MSP430Snapshot.h"
+
 struct AddressRange
 {
     uint32_t startAddr;
@@ -28,7 +32,28 @@ public:
 
     virtual void init() = 0;
     virtual void destroy() = 0;
-    virtual void update() = 0;
+
+    // Time-based devices post events on the scheduler they are attached to,
+    // onEvent() is called with the cycle and tag of each event when due.
+    void attachScheduler(EventScheduler *scheduler) { scheduler_ = scheduler; }
+    virtual void onEvent(uint64_t time, uint32_t tag) {}
+    // Devices request interrupts on the controller they are attached to
+    void attachInterrupts(InterruptController *interrupts)
+    {
+        interrupts_ = interrupts;
+    }
+
+    // Registers and internal state of the device, for machine snapshots.
+    // loadState() returns false if the state cannot be read back.
+    // checkState() reads the state without applying it, and fails where
+    // loadState() would.
+    virtual void saveState(SnapshotWriter &out) const {}
+    virtual bool loadState(SnapshotReader &in) { return true; }
+    virtual bool checkState(SnapshotReader &in) const { return true; }
+
+    // Whether readByte() and writeByte() are implemented, word-only devices
+    // assert on byte accesses
+    virtual bool hasByteAccess() const { return false; }
 
     // Function that must be implemented by derived class
     virtual uint16_t readWord(uint32_t address) = 0;
@@ -53,4 +78,8 @@ public:
 
     const std::vector<AddressRange> addressRanges_;
     const std::string name_;
+
+protected:
+    EventScheduler *scheduler_ = nullptr;
+    InterruptController *interrupts_ = nullptr;
 };
@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <iostream>
 #include <memory>
 
 #include "DevicesManager.h"
+#include "MSP430Trace.h"
 #include "MSP430Watchdog.h"
 #include "Memory.h"
 #include "Port.h"
@@ -18,7 +20,15 @@
 
 using DeviceFactory = std::function<std::shared_ptr<Device>()>;
 
-DevicesManager::DevicesManager() { loadInternalDevices(); }
+DevicesManager::DevicesManager()
+{
+    pageDevices_.fill(nullptr);
+    pageReadData_.fill(nullptr);
+    pageWriteData_.fill(nullptr);
+    codePages_.fill(false);
+    watchedPages_.fill(0);
+    loadInternalDevices();
+}
 
 void DevicesManager::loadInternalDevices()
 {
@@ -45,23 +55,28 @@ void DevicesManager::loadInternalDevices()
         // device->init();
         internalDevices_.push_back(device);
 
-        // Register each address range for the device
-        for (const auto &range : device->addressRanges_)
-        {
-            registerDeviceRange(range.startAddr, range.endAddr, device.get());
-        }
-
         // Check if this device is the Memory device and, if so, set
         // memoryDevice_
         if (auto memoryDevice = std::dynamic_pointer_cast<Memory>(device))
         {
             memoryDevice_ = memoryDevice;
+            memoryDevice_->setPageListener(this);
         }
         else if (auto port = std::dynamic_pointer_cast<Port>(device))
         {
+            port->attachInputLog(&inputLog_, portIndex);
             ports_[portIndex] = port;
             portIndex++;
         }
+
+        // Register each address range for the device
+        for (const auto &range : device->addressRanges_)
+        {
+            registerDeviceRange(range.startAddr, range.endAddr, device.get());
+        }
+
+        device->attachScheduler(&scheduler_);
+        device->attachInterrupts(&interrupts_);
     }
 }
 
@@ -98,24 +113,371 @@ void DevicesManager::dump(uint32_t address, uint32_t len)
     printf("\n");
 }
 
+void DevicesManager::attachPeripheral(uint8_t port, Peripheral *peripheral)
+{
+    ports_[port - 1]->attachPeripheral(peripheral);
+}
+
 void DevicesManager::registerPeripheral(uint8_t port, RxCBType rxCb,
                                         TxCBType txCb)
 {
     ports_[port - 1]->registerPeripheral(rxCb, txCb);
 }
 
+void DevicesManager::unregisterPeripherals()
+{
+    for (auto &port : ports_)
+    {
+        port->unregisterPeripherals();
+    }
+}
+
+void DevicesManager::flushPinChanges()
+{
+    for (auto &port : ports_)
+    {
+        port->flushPinChanges();
+    }
+}
+
 void DevicesManager::registerDeviceRange(uint32_t startAddress,
                                          uint32_t endAddress, Device *device)
 {
-    std::cout << "register device " << device->name_ << std::hex << startAddress
-              << " to " << endAddress << std::endl;
-    for (uint32_t address = startAddress; address <= endAddress; ++address)
+    TRACE_INFO(TRACE_BUS, "register device %s %X to %X\n",
+               device->name_.c_str(), startAddress, endAddress);
+    assert(startAddress <= endAddress);
+
+    // Keep only the parts of the range not claimed by a previously registered
+    // device: the first registered device wins.
+    std::vector<DeviceRange> newRanges;
+    uint32_t address = startAddress;
+    bool done = false;
+
+    for (const auto &range : deviceRanges_)
+    {
+        if (range.endAddr < address)
+        {
+            continue;
+        }
+        if (range.startAddr > endAddress)
+        {
+            break;
+        }
+        if (range.startAddr > address)
+        {
+            newRanges.push_back({address, range.startAddr - 1, device});
+        }
+        if (range.endAddr >= endAddress)
+        {
+            done = true;
+            break;
+        }
+        address = range.endAddr + 1;
+    }
+    if (!done)
+    {
+        newRanges.push_back({address, endAddress, device});
+    }
+
+    for (const auto &range : newRanges)
+    {
+        auto it = std::lower_bound(deviceRanges_.begin(), deviceRanges_.end(),
+                                   range.startAddr,
+                                   [](const DeviceRange &r, uint32_t addr)
+                                   { return r.startAddr < addr; });
+        deviceRanges_.insert(it, range);
+        mapDeviceRange(range.startAddr, range.endAddr, device);
+    }
+}
+
+/**
+ * Maps an address range to a device in the bus page table.
+ *
+ * Addresses already mapped keep their device, so the first registered device
+ * wins, as for deviceRanges_. A page entirely covered by one device is stored
+ * as a single pointer, partially covered pages get a per-address sub-table.
+ */
+void DevicesManager::mapDeviceRange(uint32_t startAddress, uint32_t endAddress,
+                                    Device *device)
+{
+    if (startAddress >= (NB_PAGES << PAGE_SHIFT))
+    {
+        return;
+    }
+    endAddress = std::min(endAddress, (NB_PAGES << PAGE_SHIFT) - 1);
+
+    for (uint32_t page = startAddress >> PAGE_SHIFT;
+         page <= (endAddress >> PAGE_SHIFT); page++)
+    {
+        uint32_t pageStart = page << PAGE_SHIFT;
+        uint32_t first = std::max(startAddress, pageStart);
+        uint32_t last = std::min(endAddress, pageStart + PAGE_MASK);
+
+        // Page already owned by a single device
+        if (pageDevices_[page] != nullptr)
+        {
+            continue;
+        }
+
+        if (!pageSubTables_[page] && (first == pageStart) &&
+            (last == pageStart + PAGE_MASK))
+        {
+            pageDevices_[page] = device;
+            updatePageData(page);
+            continue;
+        }
+
+        if (!pageSubTables_[page])
+        {
+            pageSubTables_[page] = std::make_unique<PageSubTable>();
+            pageSubTables_[page]->fill(nullptr);
+        }
+
+        PageSubTable &subTable = *pageSubTables_[page];
+        for (uint32_t address = first; address <= last; address++)
+        {
+            if (subTable[address & PAGE_MASK] == nullptr)
+            {
+                subTable[address & PAGE_MASK] = device;
+            }
+        }
+    }
+}
+
+void DevicesManager::updatePageData(uint32_t page)
+{
+    uint32_t pageEnd = (page << PAGE_SHIFT) + PAGE_MASK;
+
+    // Only pages fully backed by the memory array can bypass the device
+    if ((pageDevices_[page] != nullptr) &&
+        (pageDevices_[page] == memoryDevice_.get()) &&
+        (pageEnd < memoryDevice_->size()))
+    {
+        pageReadData_[page] = memoryDevice_->data() + (page << PAGE_SHIFT);
+    }
+    else
+    {
+        pageReadData_[page] = nullptr;
+    }
+    if (codePages_[page] || watchedPages_[page] ||
+        (pageReadData_[page] == nullptr) ||
+        !memoryDevice_->isDirty(page))
+    {
+        pageWriteData_[page] = nullptr;
+    }
+    else
+    {
+        pageWriteData_[page] = pageReadData_[page];
+    }
+}
+
+/**
+ * Memory pages get a write pointer once dirty: the first write after a
+ * checkpoint takes the slow path to let Memory save the page. Pages
+ * rewritten by a restore are reported as code writes.
+ */
+void DevicesManager::onPageChanged(uint32_t page, bool contentChanged)
+{
+    static_assert(PAGE_SHIFT == Memory::PAGE_SHIFT,
+                  "memory pages must match the bus pages");
+
+    if (contentChanged)
+    {
+        notifyCodeWrite(page << PAGE_SHIFT, PAGE_SIZE);
+    }
+    updatePageData(page);
+}
+
+void DevicesManager::setCodeWriteListener(CodeWriteListener *listener)
+{
+    codeWriteListener_ = listener;
+}
+
+void DevicesManager::markCodePage(uint32_t address)
+{
+    uint32_t page = address >> PAGE_SHIFT;
+
+    if ((page < NB_PAGES) && !codePages_[page])
+    {
+        codePages_[page] = true;
+        updatePageData(page);
+    }
+}
+
+void DevicesManager::clearCodePages()
+{
+    for (uint32_t page = 0; page < NB_PAGES; page++)
+    {
+        if (codePages_[page])
+        {
+            codePages_[page] = false;
+            updatePageData(page);
+        }
+    }
+}
+
+void DevicesManager::addWriteWatch(uint32_t address)
+{
+    uint32_t page = address >> PAGE_SHIFT;
+
+    if (page < NB_PAGES)
+    {
+        writeWatches_.insert(address);
+        watchedPages_[page]++;
+        updatePageData(page);
+    }
+}
+
+void DevicesManager::removeWriteWatch(uint32_t address)
+{
+    auto watch = writeWatches_.find(address);
+
+    if (watch != writeWatches_.end())
+    {
+        writeWatches_.erase(watch);
+        watchedPages_[address >> PAGE_SHIFT]--;
+        updatePageData(address >> PAGE_SHIFT);
+    }
+}
+
+void DevicesManager::clearWriteWatches()
+{
+    while (!writeWatches_.empty())
+    {
+        removeWriteWatch(*writeWatches_.begin());
+    }
+    watchHit_ = false;
+}
+
+void DevicesManager::checkWriteWatch(uint32_t address, uint32_t nbBytes)
+{
+    if (writeWatches_.empty())
+    {
+        return;
+    }
+
+    auto watch = writeWatches_.lower_bound(address);
+    if ((watch != writeWatches_.end()) && (*watch < address + nbBytes))
+    {
+        watchHit_ = true;
+    }
+}
+
+void DevicesManager::notifyCodeWrite(uint32_t address, uint32_t nbBytes)
+{
+    uint32_t firstPage = address >> PAGE_SHIFT;
+    uint32_t lastPage = (address + nbBytes - 1) >> PAGE_SHIFT;
+
+    if (codeWriteListener_ == nullptr)
+    {
+        return;
+    }
+
+    for (uint32_t page = firstPage; (page <= lastPage) && (page < NB_PAGES);
+         page++)
+    {
+        if (codePages_[page])
+        {
+            codeWriteListener_->onCodeWrite(address, nbBytes);
+            return;
+        }
+    }
+}
+
+std::vector<Device *> DevicesManager::getInternalDevices() const
+{
+    std::vector<Device *> devices;
+
+    for (const auto &device : internalDevices_)
+    {
+        devices.push_back(device.get());
+    }
+    return devices;
+}
+
+bool DevicesManager::saveState(SnapshotWriter &out, bool incremental)
+{
+    if ((incremental && !memoryDevice_->hasCheckpoint()) ||
+        !scheduler_.saveState(out, getInternalDevices()))
+    {
+        return false;
+    }
+
+    if (!incremental)
+    {
+        memoryDevice_->checkpoint();
+    }
+
+    interrupts_.saveState(out);
+    out.write((uint32_t) internalDevices_.size());
+    for (const auto &device : internalDevices_)
+    {
+        out.writeString(device->name_);
+        if (incremental && (device == memoryDevice_))
+        {
+            memoryDevice_->saveDirtyState(out);
+        }
+        else
+        {
+            device->saveState(out);
+        }
+    }
+    return true;
+}
+
+/**
+ * Restores the internal devices. Code pages whose content changes are
+ * reported to the code write listener; the cached code of the others is
+ * kept, so restoring the same snapshot again and again stays cheap.
+ */
+bool DevicesManager::loadState(SnapshotReader &in)
+{
+    uint32_t count;
+    std::string name;
+
+    if (!scheduler_.loadState(in, getInternalDevices()) ||
+        !interrupts_.loadState(in) || !in.read(count) ||
+        (count != internalDevices_.size()))
+    {
+        return false;
+    }
+
+    for (const auto &device : internalDevices_)
     {
-        if (devicesMap_.find(address) == devicesMap_.end())
+        if (!in.readString(name) || (name != device->name_))
+        {
+            return false;
+        }
+
+        if (!device->loadState(in))
         {
-            devicesMap_[address] = device;
+            return false;
         }
     }
+    return true;
+}
+
+bool DevicesManager::checkState(SnapshotReader &in) const
+{
+    uint32_t count;
+    std::string name;
+
+    if (!scheduler_.checkState(in, internalDevices_.size()) ||
+        !interrupts_.checkState(in) || !in.read(count) ||
+        (count != internalDevices_.size()))
+    {
+        return false;
+    }
+
+    for (const auto &device : internalDevices_)
+    {
+        if (!in.readString(name) || (name != device->name_) ||
+            !device->checkState(in))
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 template <typename T>
@@ -124,21 +486,31 @@ void DevicesManager::instantiateAndRegisterDevice(uint32_t startAddress,
 {
     T *device = new T();
     device->init();
+    device->attachScheduler(&scheduler_);
+    device->attachInterrupts(&interrupts_);
     registerDeviceRange(startAddress, endAddress, device);
 }
 
 Device *DevicesManager::getDeviceForAddress(uint32_t address)
 {
+    uint32_t page = address >> PAGE_SHIFT;
+    Device *device = nullptr;
+
     // Check for specific devices first
-    if (devicesMap_.count(address))
+    if (page < NB_PAGES)
     {
-        return devicesMap_[address];
+        device = pageDevices_[page];
+        if ((device == nullptr) && pageSubTables_[page])
+        {
+            device = (*pageSubTables_[page])[address & PAGE_MASK];
+        }
     }
+
     // Otherwise, return memory
-    return memoryDevice_.get();
+    return device ? device : memoryDevice_.get();
 }
 
-uint8_t DevicesManager::readByte(uint32_t address)
+uint8_t DevicesManager::readByteSlow(uint32_t address)
 {
     Device *device = getDeviceForAddress(address);
     // std::cout << "dm read byte from dev " << device->name_ <<  " **** " <<
@@ -146,39 +518,98 @@ uint8_t DevicesManager::readByte(uint32_t address)
     return device->readByte(address);
 }
 
-uint16_t DevicesManager::readWord(uint32_t address)
+uint16_t DevicesManager::readWordSlow(uint32_t address)
 {
     Device *device = getDeviceForAddress(address);
-    std::cout << "dm read word **** " << device->name_ << " @" << std::hex
-              << address << std::endl;
+    TRACE_DEBUG(TRACE_BUS, "read word %s @%X\n", device->name_.c_str(),
+                address);
     return device->readWord(address);
 }
 
-uint32_t DevicesManager::readDWord(uint32_t address)
+uint32_t DevicesManager::readDWordSlow(uint32_t address)
 {
-    std::cout << "dm read Dword **** " << std::hex << address << std::endl;
+    TRACE_DEBUG(TRACE_BUS, "read dword @%X\n", address);
     Device *device = getDeviceForAddress(address);
     return device->readDWord(address);
 }
 
-void DevicesManager::writeByte(uint32_t address, uint8_t value)
+void DevicesManager::writeByteSlow(uint32_t address, uint8_t value)
 {
     Device *device = getDeviceForAddress(address);
+    checkWriteWatch(address, 1);
+    notifyCodeWrite(address, 1);
     device->writeByte(address, value);
 }
 
-void DevicesManager::writeWord(uint32_t address, uint16_t value)
+void DevicesManager::writeWordSlow(uint32_t address, uint16_t value)
 {
     Device *device = getDeviceForAddress(address);
+    checkWriteWatch(address, 2);
+    notifyCodeWrite(address, 2);
     device->writeWord(address, value);
 }
 
-void DevicesManager::writeDWord(uint32_t address, uint32_t value)
+void DevicesManager::writeDWordSlow(uint32_t address, uint32_t value)
 {
     Device *device = getDeviceForAddress(address);
+    checkWriteWatch(address, 4);
+    notifyCodeWrite(address, 4);
     device->writeDWord(address, value);
 }
 
+bool DevicesManager::isValidRange(uint32_t address, size_t size)
+{
+    // Memory holds MSP430F2618_MAX_MEMORY_ADDRESS bytes
+    return (address <= MSP430F2618_MAX_MEMORY_ADDRESS) &&
+           (size <= MSP430F2618_MAX_MEMORY_ADDRESS - address);
+}
+
+bool DevicesManager::debugRead(uint32_t address, uint8_t *buffer, size_t size)
+{
+    if (!isValidRange(address, size))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        uint32_t byteAddress = address + i;
+        Device *device = getDeviceForAddress(byteAddress);
+        if (device->hasByteAccess())
+        {
+            buffer[i] = readByte(byteAddress);
+        }
+        else
+        {
+            uint16_t word = device->readWord(byteAddress & ~1u);
+            buffer[i] = (byteAddress & 1) ? (word >> 8) : (word & 0xFF);
+        }
+    }
+    return true;
+}
+
+bool DevicesManager::debugWrite(uint32_t address, const uint8_t *data,
+                                size_t size)
+{
+    if (!isValidRange(address, size))
+    {
+        return false;
+    }
+    for (size_t i = 0; i < size; i++)
+    {
+        if (!getDeviceForAddress(address + i)->hasByteAccess())
+        {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        writeByte(address + i, data[i]);
+    }
+    return true;
+}
+
 uint32_t DevicesManager::read(uint32_t address, uint32_t nbBytes)
 {
     switch (nbBytes)
@@ -213,10 +644,3 @@ void DevicesManager::write(uint32_t address, uint32_t value, uint32_t nbBytes)
     }
 }
 
-void DevicesManager::updateAllDevices()
-{
-    for (const auto &entry : devicesMap_)
-    {
-        entry.second->update();
-    }
-}
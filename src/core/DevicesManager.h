@@ -1,7 +1,8 @@
 #pragma once
 
-#include <map>
+#include <array>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -10,7 +11,24 @@
 #include "Memory.h"
 #include "Port.h"
 
-class DevicesManager
+// Address interval owned by a device on the bus
+struct DeviceRange
+{
+    uint32_t startAddr;
+    uint32_t endAddr;
+    Device *device;
+};
+
+// Notified of bus writes hitting pages registered with markCodePage(), so
+// that cached decoded code can be invalidated.
+class CodeWriteListener
+{
+public:
+    virtual ~CodeWriteListener() = default;
+    virtual void onCodeWrite(uint32_t address, uint32_t nbBytes) = 0;
+};
+
+class DevicesManager : private MemoryPageListener
 {
 public:
     DevicesManager();
@@ -22,30 +40,140 @@ public:
     void instantiateAndRegisterDevice(uint32_t startAddress,
                                       uint32_t endAddress);
 
-    uint8_t readByte(uint32_t address);
-    uint16_t readWord(uint32_t address);
-    uint32_t readDWord(uint32_t address);
-    void writeByte(uint32_t address, uint8_t value);
-    void writeWord(uint32_t address, uint16_t value);
-    void writeDWord(uint32_t address, uint32_t value);
+    // Bus accessors. Accesses to pages backed by plain memory (RAM/flash) are
+    // served inline from the page table, everything else is dispatched to
+    // the device owning the address.
+    inline uint8_t readByte(uint32_t address);
+    inline uint16_t readWord(uint32_t address);
+    inline uint32_t readDWord(uint32_t address);
+    inline void writeByte(uint32_t address, uint8_t value);
+    inline void writeWord(uint32_t address, uint16_t value);
+    inline void writeDWord(uint32_t address, uint32_t value);
 
     uint32_t read(uint32_t address, uint32_t nbBytes);
     void write(uint32_t address, uint32_t value, uint32_t nbBytes);
 
-    void updateAllDevices();
+    // Accesses of debuggers and embedders, which must not abort on bad
+    // addresses. Bytes of word-only devices are read from their word, and
+    // writing them is refused. Both return false, without accessing the
+    // bus, if a byte of the range cannot be accessed.
+    static bool isValidRange(uint32_t address, size_t size);
+    bool debugRead(uint32_t address, uint8_t *buffer, size_t size);
+    bool debugWrite(uint32_t address, const uint8_t *data, size_t size);
+
+    // Fires the device events due at now, in CPU cycles. Inline so that
+    // the CPU loop only pays a compare until the next deadline.
+    void runEvents(uint64_t now)
+    {
+        if (now >= scheduler_.nextEventTime())
+        {
+            scheduler_.run(now);
+        }
+    }
+    uint64_t getNextEventTime() const { return scheduler_.nextEventTime(); }
+    EventScheduler &getScheduler() { return scheduler_; }
+    InputLog &getInputLog() { return inputLog_; }
+    InterruptController &getInterrupts() { return interrupts_; }
 
     std::shared_ptr<Memory> getMemoryDevice() const { return memoryDevice_; }
 
     void dump(uint32_t address, uint32_t len);
 
+    // Ports are numbered from 1
+    void attachPeripheral(uint8_t port, Peripheral *peripheral);
     void registerPeripheral(uint8_t port, RxCBType rxCb, TxCBType txCb);
+    void unregisterPeripherals();
+    // Delivers the port output changes buffered so far
+    void flushPinChanges();
+
+    // State of the internal devices and of their pending events. A full
+    // state makes a memory checkpoint; an incremental one only holds the
+    // memory pages written since, and fails if there is no checkpoint.
+    bool saveState(SnapshotWriter &out, bool incremental = false);
+    bool loadState(SnapshotReader &in);
+    // Reads a state without applying it, fails where loadState() would
+    bool checkState(SnapshotReader &in) const;
+
+    // Code pages: writes to pages holding cached decoded instructions leave
+    // the fast path and are reported to the code write listener.
+    void setCodeWriteListener(CodeWriteListener *listener);
+    void markCodePage(uint32_t address);
+    void clearCodePages();
+
+    // Write watches: pages holding a watched address leave the fast path,
+    // and takeWatchHit() tells, once, if one of them was written
+    void addWriteWatch(uint32_t address);
+    void removeWriteWatch(uint32_t address);
+    void clearWriteWatches();
+    bool hasWriteWatches() const { return !writeWatches_.empty(); }
+    bool takeWatchHit()
+    {
+        bool hit = watchHit_;
+        watchHit_ = false;
+        return hit;
+    }
+
+    // Page data of the fast path, NB_PAGES entries, for translated code
+    uint8_t *const *getPageReadData() const { return pageReadData_.data(); }
+    uint8_t *const *getPageWriteData() const
+    {
+        return pageWriteData_.data();
+    }
+
+    // Bus page table geometry
+    static constexpr uint32_t PAGE_SHIFT = 9;
+    static constexpr uint32_t PAGE_SIZE = 1 << PAGE_SHIFT;
+    static constexpr uint32_t PAGE_MASK = PAGE_SIZE - 1;
+    static constexpr uint32_t NB_PAGES =
+        (MSP430F2618_MAX_MEMORY_ADDRESS + 1) >> PAGE_SHIFT;
 
 private:
+    typedef std::array<Device *, PAGE_SIZE> PageSubTable;
+    typedef std::array<uint8_t *, NB_PAGES> PageDataTable;
+
     void loadInternalDevices();
     void loadDevice(const std::string &deviceName);
+    void mapDeviceRange(uint32_t startAddress, uint32_t endAddress,
+                        Device *device);
+    void updatePageData(uint32_t page);
+    inline uint8_t *getPageData(const PageDataTable &table, uint32_t address,
+                                uint32_t nbBytes) const;
+    void notifyCodeWrite(uint32_t address, uint32_t nbBytes);
+    void checkWriteWatch(uint32_t address, uint32_t nbBytes);
+    void onPageChanged(uint32_t page, bool contentChanged) override;
+    std::vector<Device *> getInternalDevices() const;
     Device *getDeviceForAddress(uint32_t address);
 
-    std::map<int, Device *> devicesMap_; // Map of address to device
+    uint8_t readByteSlow(uint32_t address);
+    uint16_t readWordSlow(uint32_t address);
+    uint32_t readDWordSlow(uint32_t address);
+    void writeByteSlow(uint32_t address, uint8_t value);
+    void writeWordSlow(uint32_t address, uint16_t value);
+    void writeDWordSlow(uint32_t address, uint32_t value);
+
+    // Registered address intervals, sorted and non overlapping
+    std::vector<DeviceRange> deviceRanges_;
+
+    EventScheduler scheduler_;
+    InputLog inputLog_;
+    InterruptController interrupts_;
+
+    // Two-level bus page table. A page owned by a single device points to it
+    // in pageDevices_; pages shared by several devices (the peripheral area)
+    // have a nullptr there and a per-address table in pageSubTables_.
+    std::array<Device *, NB_PAGES> pageDevices_;
+    std::array<std::unique_ptr<PageSubTable>, NB_PAGES> pageSubTables_;
+    // Backing storage of pages served by plain memory, nullptr otherwise.
+    // Code pages and clean memory pages have no write pointer so that
+    // writes take the slow path.
+    PageDataTable pageReadData_;
+    PageDataTable pageWriteData_;
+    std::array<bool, NB_PAGES> codePages_;
+    std::array<uint16_t, NB_PAGES> watchedPages_; // watches in each page
+    std::multiset<uint32_t> writeWatches_;
+    bool watchHit_ = false;
+    CodeWriteListener *codeWriteListener_ = nullptr;
+
     std::shared_ptr<Memory> memoryDevice_;
     std::array<std::shared_ptr<Port>, 8> ports_;
     // std::vector<std::shared_ptr<Device>> devices_; // External devices
@@ -53,3 +181,79 @@ private:
     // Internal devices intrinsic to the microcontroller
     std::vector<std::shared_ptr<Device>> internalDevices_;
 };
+
+inline uint8_t *DevicesManager::getPageData(const PageDataTable &table,
+                                           uint32_t address,
+                                           uint32_t nbBytes) const
+{
+    uint32_t page = address >> PAGE_SHIFT;
+
+    // Accesses crossing a page boundary take the slow path
+    if ((page >= NB_PAGES) || ((address & PAGE_MASK) > PAGE_SIZE - nbBytes))
+    {
+        return nullptr;
+    }
+
+    uint8_t *data = table[page];
+    return data ? data + (address & PAGE_MASK) : nullptr;
+}
+
+inline uint8_t DevicesManager::readByte(uint32_t address)
+{
+    uint8_t *data = getPageData(pageReadData_, address, 1);
+    return data ? data[0] : readByteSlow(address);
+}
+
+inline uint16_t DevicesManager::readWord(uint32_t address)
+{
+    uint8_t *data = getPageData(pageReadData_, address, 2);
+    return data ? (data[0] | (data[1] << 8)) : readWordSlow(address);
+}
+
+inline uint32_t DevicesManager::readDWord(uint32_t address)
+{
+    uint8_t *data = getPageData(pageReadData_, address, 4);
+    if (data)
+    {
+        return data[0] | (data[1] << 8) | (data[2] << 16) |
+               ((uint32_t) data[3] << 24);
+    }
+    return readDWordSlow(address);
+}
+
+inline void DevicesManager::writeByte(uint32_t address, uint8_t value)
+{
+    uint8_t *data = getPageData(pageWriteData_, address, 1);
+    if (data)
+    {
+        data[0] = value;
+        return;
+    }
+    writeByteSlow(address, value);
+}
+
+inline void DevicesManager::writeWord(uint32_t address, uint16_t value)
+{
+    uint8_t *data = getPageData(pageWriteData_, address, 2);
+    if (data)
+    {
+        data[0] = value & 0xFF;
+        data[1] = (value >> 8) & 0xFF;
+        return;
+    }
+    writeWordSlow(address, value);
+}
+
+inline void DevicesManager::writeDWord(uint32_t address, uint32_t value)
+{
+    uint8_t *data = getPageData(pageWriteData_, address, 4);
+    if (data)
+    {
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            data[i] = (value >> (8 * i)) & 0xFF;
+        }
+        return;
+    }
+    writeDWordSlow(address, value);
+}
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <utility>
+
+#include "Device.h"
+#include "EventScheduler.h"
+
+EventId EventScheduler::post(uint64_t time, Device *device, uint32_t tag)
+{
+    EventId id;
+
+    if (freeIds_.empty())
+    {
+        id = events_.size();
+        events_.push_back({});
+    }
+    else
+    {
+        id = freeIds_.back();
+        freeIds_.pop_back();
+    }
+
+    events_[id] = {time, sequence_++, device, tag, (uint32_t) heap_.size()};
+    heap_.push_back(id);
+    siftUp(heap_.size() - 1);
+    updateNextTime();
+    return id;
+}
+
+bool EventScheduler::cancel(EventId id)
+{
+    if (!isPending(id))
+    {
+        return false;
+    }
+
+    remove(id);
+    updateNextTime();
+    return true;
+}
+
+bool EventScheduler::reschedule(EventId id, uint64_t time)
+{
+    if (!isPending(id))
+    {
+        return false;
+    }
+
+    Event &event = events_[id];
+    uint64_t previous = event.time;
+
+    event.time = time;
+    event.sequence = sequence_++;
+    if (time < previous)
+    {
+        siftUp(event.heapIndex);
+    }
+    else
+    {
+        siftDown(event.heapIndex);
+    }
+    updateNextTime();
+    return true;
+}
+
+bool EventScheduler::isPending(EventId id) const
+{
+    return (id < events_.size()) && (events_[id].heapIndex != INVALID_EVENT);
+}
+
+void EventScheduler::run(uint64_t now)
+{
+    while (!heap_.empty() && (events_[heap_[0]].time <= now))
+    {
+        EventId id = heap_[0];
+        Event event = events_[id];
+
+        // The event is freed first: its handler may post new events
+        remove(id);
+        updateNextTime();
+        event.device->onEvent(event.time, event.tag);
+    }
+}
+
+void EventScheduler::clear()
+{
+    events_.clear();
+    heap_.clear();
+    freeIds_.clear();
+    nextTime_ = NO_EVENT;
+}
+
+bool EventScheduler::saveState(SnapshotWriter &out,
+                               const std::vector<Device *> &devices) const
+{
+    out.write(sequence_);
+    out.write((uint32_t) events_.size());
+    for (const Event &event : events_)
+    {
+        uint32_t device = INVALID_EVENT;
+
+        if (event.heapIndex != INVALID_EVENT)
+        {
+            auto it = std::find(devices.begin(), devices.end(), event.device);
+            if (it == devices.end())
+            {
+                return false;
+            }
+            device = it - devices.begin();
+        }
+        out.write(event.time);
+        out.write(event.sequence);
+        out.write(device);
+        out.write(event.tag);
+    }
+
+    // Free ids are reused in order, keep it for a deterministic replay
+    out.write((uint32_t) freeIds_.size());
+    out.write(freeIds_.data(), freeIds_.size() * sizeof(EventId));
+    return true;
+}
+
+bool EventScheduler::checkState(SnapshotReader &in, size_t nbDevices) const
+{
+    uint64_t sequence;
+    uint32_t count;
+    uint32_t freeCount;
+    // Slots without a pending event, each can be listed once as free
+    std::vector<uint8_t> freeSlots;
+
+    if (!in.read(sequence) || !in.read(count))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Event event;
+        uint32_t device;
+
+        if (!in.read(event.time) || !in.read(event.sequence) ||
+            !in.read(device) || !in.read(event.tag) ||
+            ((device != INVALID_EVENT) && (device >= nbDevices)))
+        {
+            return false;
+        }
+        freeSlots.push_back(device == INVALID_EVENT);
+    }
+
+    if (!in.read(freeCount) || (freeCount > count))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < freeCount; i++)
+    {
+        EventId id;
+
+        if (!in.read(id) || (id >= count) || !freeSlots[id])
+        {
+            return false;
+        }
+        freeSlots[id] = 0;
+    }
+    return true;
+}
+
+bool EventScheduler::loadState(SnapshotReader &in,
+                               const std::vector<Device *> &devices)
+{
+    uint32_t count;
+    uint32_t freeCount;
+
+    clear();
+    if (!in.read(sequence_) || !in.read(count))
+    {
+        return false;
+    }
+
+    // Ids are kept, so that devices can still cancel their events
+    events_.resize(count);
+    for (EventId id = 0; id < count; id++)
+    {
+        Event &event = events_[id];
+        uint32_t device;
+
+        if (!in.read(event.time) || !in.read(event.sequence) ||
+            !in.read(device) || !in.read(event.tag))
+        {
+            clear();
+            return false;
+        }
+
+        if (device == INVALID_EVENT)
+        {
+            event.device = nullptr;
+            event.heapIndex = INVALID_EVENT;
+        }
+        else if (device < devices.size())
+        {
+            event.device = devices[device];
+            event.heapIndex = heap_.size();
+            heap_.push_back(id);
+            siftUp(event.heapIndex);
+        }
+        else
+        {
+            clear();
+            return false;
+        }
+    }
+
+    if (!in.read(freeCount) || (freeCount > count))
+    {
+        clear();
+        return false;
+    }
+    freeIds_.resize(freeCount);
+    if (!in.read(freeIds_.data(), freeCount * sizeof(EventId)))
+    {
+        clear();
+        return false;
+    }
+
+    // post() hands the free ids out again: they must be free slots, listed
+    // once
+    std::vector<uint8_t> listed(count);
+    for (EventId id : freeIds_)
+    {
+        if ((id >= count) || (events_[id].heapIndex != INVALID_EVENT) ||
+            listed[id])
+        {
+            clear();
+            return false;
+        }
+        listed[id] = 1;
+    }
+
+    updateNextTime();
+    return true;
+}
+
+bool EventScheduler::isBefore(EventId a, EventId b) const
+{
+    const Event &eventA = events_[a];
+    const Event &eventB = events_[b];
+
+    if (eventA.time != eventB.time)
+    {
+        return eventA.time < eventB.time;
+    }
+    return eventA.sequence < eventB.sequence;
+}
+
+void EventScheduler::swapHeap(uint32_t a, uint32_t b)
+{
+    std::swap(heap_[a], heap_[b]);
+    events_[heap_[a]].heapIndex = a;
+    events_[heap_[b]].heapIndex = b;
+}
+
+void EventScheduler::siftUp(uint32_t index)
+{
+    while (index > 0)
+    {
+        uint32_t parent = (index - 1) / 2;
+
+        if (!isBefore(heap_[index], heap_[parent]))
+        {
+            break;
+        }
+        swapHeap(index, parent);
+        index = parent;
+    }
+}
+
+void EventScheduler::siftDown(uint32_t index)
+{
+    while (true)
+    {
+        uint32_t first = index;
+        uint32_t left = 2 * index + 1;
+        uint32_t right = left + 1;
+
+        if ((left < heap_.size()) && isBefore(heap_[left], heap_[first]))
+        {
+            first = left;
+        }
+        if ((right < heap_.size()) && isBefore(heap_[right], heap_[first]))
+        {
+            first = right;
+        }
+        if (first == index)
+        {
+            break;
+        }
+        swapHeap(index, first);
+        index = first;
+    }
+}
+
+void EventScheduler::remove(EventId id)
+{
+    uint32_t index = events_[id].heapIndex;
+    uint32_t last = heap_.size() - 1;
+
+    if (index != last)
+    {
+        swapHeap(index, last);
+    }
+    heap_.pop_back();
+    events_[id].heapIndex = INVALID_EVENT;
+    freeIds_.push_back(id);
+
+    // The last event moved to the freed position may need to go either way
+    if (index < heap_.size())
+    {
+        EventId moved = heap_[index];
+
+        siftUp(index);
+        siftDown(events_[moved].heapIndex);
+    }
+}
+
+void EventScheduler::updateNextTime()
+{
+    nextTime_ = heap_.empty() ? NO_EVENT : events_[heap_[0]].time;
+}
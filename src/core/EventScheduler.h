@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "MSP430Snapshot.h"
+
+class Device;
+
+// Handle of a posted event, valid until the event fires or is cancelled
+typedef uint32_t EventId;
+
+/**
+ * Discrete event scheduler of the devices.
+ *
+ * Devices post events due at a given CPU cycle, and are called back through
+ * Device::onEvent() once the CPU time base reaches it. Events are kept in a
+ * binary min-heap keyed by their due cycle; the heap position of every
+ * event is tracked so that cancel() and reschedule() are O(log n). Events
+ * due at the same cycle fire in the order they were posted.
+ */
+class EventScheduler
+{
+public:
+    static constexpr uint64_t NO_EVENT = UINT64_MAX;
+    static constexpr EventId INVALID_EVENT = UINT32_MAX;
+
+    // Current CPU time, read from the cycle counter given to setClock()
+    void setClock(const uint64_t *clock) { clock_ = clock; }
+    uint64_t now() const { return clock_ ? *clock_ : 0; }
+
+    EventId post(uint64_t time, Device *device, uint32_t tag = 0);
+    // Both return false if the event is not pending anymore
+    bool cancel(EventId id);
+    bool reschedule(EventId id, uint64_t time);
+    bool isPending(EventId id) const;
+
+    uint64_t nextEventTime() const { return nextTime_; }
+    // Read directly by translated code
+    const uint64_t *getNextEventTimePtr() const { return &nextTime_; }
+    // Fires, in time order, every event due at or before now
+    void run(uint64_t now);
+    void clear();
+
+    // Pending events, with their ids, for machine snapshots. Devices are
+    // saved as their index in devices; saveState() fails if an event
+    // belongs to another device.
+    bool saveState(SnapshotWriter &out,
+                   const std::vector<Device *> &devices) const;
+    bool loadState(SnapshotReader &in, const std::vector<Device *> &devices);
+    // Reads a state without applying it, fails where loadState() would
+    bool checkState(SnapshotReader &in, size_t nbDevices) const;
+
+private:
+    struct Event
+    {
+        uint64_t time;
+        uint64_t sequence; // posting order, for events due at the same time
+        Device *device;
+        uint32_t tag;
+        uint32_t heapIndex; // INVALID_EVENT when the slot is free
+    };
+
+    bool isBefore(EventId a, EventId b) const;
+    void swapHeap(uint32_t a, uint32_t b);
+    void siftUp(uint32_t index);
+    void siftDown(uint32_t index);
+    void remove(EventId id);
+    void updateNextTime();
+
+    std::vector<Event> events_; // indexed by EventId
+    std::vector<EventId> heap_;
+    std::vector<EventId> freeIds_;
+    uint64_t sequence_ = 0;
+    uint64_t nextTime_ = NO_EVENT;
+    const uint64_t *clock_ = nullptr;
+};
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include "InputLog.h"
+#include "MSP430Trace.h"
+
+// Marks the start of an input log ("M43I")
+static constexpr uint32_t INPUT_LOG_MAGIC = 0x4933344D;
+static constexpr size_t HEADER_SIZE = 8;
+
+static void writeVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(value);
+}
+
+static bool readVarint(const std::vector<uint8_t> &in, size_t &offset,
+                       uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; (shift < 64) && (offset < in.size()); shift += 7)
+    {
+        uint8_t byte = in[offset++];
+
+        value |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void writeHeader(std::vector<uint8_t> &out)
+{
+    for (uint32_t field : {INPUT_LOG_MAGIC, InputLog::VERSION})
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            out.push_back((field >> (8 * i)) & 0xFF);
+        }
+    }
+}
+
+InputLog::InputLog() : mode_(INPUT_LIVE), clock_(nullptr) { reset(); }
+
+void InputLog::reset()
+{
+    values_.fill(0);
+    known_.fill(false);
+    lastTime_ = 0;
+    offset_ = 0;
+    pending_ = false;
+}
+
+/**
+ * Starts a new log. Recording and replaying have to start from the same
+ * machine state, typically right after loading the ROM or restoring a
+ * snapshot.
+ */
+void InputLog::startRecording()
+{
+    reset();
+    log_.clear();
+    writeHeader(log_);
+    mode_ = INPUT_RECORD;
+}
+
+/**
+ * Replays a log, returns false if it is not an input log of this version.
+ */
+bool InputLog::startReplay(const std::vector<uint8_t> &log,
+                           uint64_t recordAfter)
+{
+    std::vector<uint8_t> header;
+
+    writeHeader(header);
+    if ((log.size() < HEADER_SIZE) ||
+        !std::equal(header.begin(), header.end(), log.begin()))
+    {
+        TRACE_ERROR(TRACE_PORT, "unsupported input log\n");
+        return false;
+    }
+
+    reset();
+    replay_ = log;
+    offset_ = HEADER_SIZE;
+    recordAfter_ = recordAfter;
+    mode_ = INPUT_REPLAY;
+    pending_ = readEntry();
+    return true;
+}
+
+// Back to live inputs, the recorded log is kept
+void InputLog::stop() { mode_ = INPUT_LIVE; }
+
+bool InputLog::saveLog(const std::string &filename) const
+{
+    std::ofstream file(filename, std::ios::binary);
+
+    file.write((const char *) log_.data(), log_.size());
+    return file.good();
+}
+
+bool InputLog::replayFile(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file)
+    {
+        TRACE_ERROR(TRACE_PORT, "cannot open input log %s\n",
+                    filename.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> log((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+    return startReplay(log);
+}
+
+void InputLog::record(uint8_t channel, uint16_t value)
+{
+    uint64_t time = now();
+
+    writeVarint(log_, time - lastTime_);
+    log_.push_back(channel);
+    writeVarint(log_, value);
+
+    lastTime_ = time;
+    values_[channel] = value;
+    known_[channel] = true;
+}
+
+/**
+ * Applies the changes logged up to now, and returns the channel value. A
+ * channel is only sampled once per cycle, so the changes logged at the
+ * current cycle can all be applied.
+ */
+uint16_t InputLog::replay(uint8_t channel)
+{
+    uint64_t time = now();
+
+    while (pending_ && (pendingTime_ <= time))
+    {
+        values_[pendingChannel_] = pendingValue_;
+        known_[pendingChannel_] = true;
+        pending_ = readEntry();
+    }
+    return values_[channel];
+}
+
+// Switches from replay to recording, the log going on from the replayed one
+void InputLog::resumeRecording()
+{
+    while (pending_)
+    {
+        values_[pendingChannel_] = pendingValue_;
+        known_[pendingChannel_] = true;
+        pending_ = readEntry();
+    }
+
+    log_ = replay_;
+    mode_ = INPUT_RECORD;
+}
+
+// Decodes the next entry of the replayed log, returns false at its end
+bool InputLog::readEntry()
+{
+    uint64_t delta;
+    uint64_t value;
+
+    if ((offset_ == replay_.size()) || !readVarint(replay_, offset_, delta) ||
+        (offset_ == replay_.size()))
+    {
+        offset_ = replay_.size();
+        return false;
+    }
+
+    pendingChannel_ = replay_[offset_++];
+    if (!readVarint(replay_, offset_, value))
+    {
+        offset_ = replay_.size();
+        return false;
+    }
+
+    lastTime_ += delta;
+    pendingTime_ = lastTime_;
+    pendingValue_ = value;
+    return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+enum INPUT_LOG_MODE
+{
+    INPUT_LIVE,   // inputs read from their sources
+    INPUT_RECORD, // inputs read from their sources and logged
+    INPUT_REPLAY, // inputs read back from a log, sources are not called
+};
+
+/**
+ * Record and replay of the external inputs of the machine.
+ *
+ * Every value coming from outside the emulator (peripherals, host threads)
+ * is sampled through sample() when the firmware reads it. While recording,
+ * the changes of each input channel are logged with the CPU cycle they
+ * were seen at; replaying the log from the same initial state gives every
+ * read the value it had, bit-exactly.
+ *
+ * The log is a magic and version header followed by one entry per change:
+ * the cycles elapsed since the previous entry and the value, both as
+ * LEB128 varints, and the channel. Channels 0 to 7 are the port inputs.
+ */
+class InputLog
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t NO_RESUME = UINT64_MAX;
+
+    InputLog();
+
+    // Current CPU time, read from the cycle counter given to setClock()
+    void setClock(const uint64_t *clock) { clock_ = clock; }
+
+    void startRecording();
+    // Past the recordAfter cycle, inputs are live again and appended to
+    // the replayed log
+    bool startReplay(const std::vector<uint8_t> &log,
+                     uint64_t recordAfter = NO_RESUME);
+    void stop();
+    INPUT_LOG_MODE getMode() const { return mode_; }
+    // True once a replay has fed back every logged change
+    bool isReplayFinished() const
+    {
+        return !pending_ && (offset_ == replay_.size());
+    }
+
+    const std::vector<uint8_t> &getLog() const { return log_; }
+    bool saveLog(const std::string &filename) const;
+    bool replayFile(const std::string &filename);
+
+    // Value of an input channel, live() being only called when not
+    // replaying
+    template <typename F> uint16_t sample(uint8_t channel, F live)
+    {
+        if (mode_ == INPUT_REPLAY)
+        {
+            if (now() <= recordAfter_)
+            {
+                return replay(channel);
+            }
+            resumeRecording();
+        }
+
+        uint16_t value = live();
+        if ((mode_ == INPUT_RECORD) &&
+            (!known_[channel] || (values_[channel] != value)))
+        {
+            record(channel, value);
+        }
+        return value;
+    }
+
+private:
+    uint64_t now() const { return clock_ ? *clock_ : 0; }
+    void record(uint8_t channel, uint16_t value);
+    uint16_t replay(uint8_t channel);
+    void resumeRecording();
+    bool readEntry();
+    void reset();
+
+    INPUT_LOG_MODE mode_;
+    const uint64_t *clock_;
+
+    // Last value of each channel, recorded or replayed
+    std::array<uint16_t, 256> values_;
+    std::array<bool, 256> known_;
+    uint64_t lastTime_;
+
+    std::vector<uint8_t> log_;
+    std::vector<uint8_t> replay_;
+    size_t offset_;
+    uint64_t recordAfter_;
+    // Next entry of the replayed log, not applied yet
+    bool pending_;
+    uint64_t pendingTime_;
+    uint8_t pendingChannel_;
+    uint16_t pendingValue_;
+};
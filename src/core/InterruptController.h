@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "MSP430Snapshot.h"
+
+/**
+ * Interrupt lines of the devices, with the vector table of the MSP430F2618.
+ *
+ * Line n is served by the vector at VECTOR_TABLE + 2 * n, the highest line
+ * having the highest priority. Requests are kept as one pending bitmask,
+ * so the CPU only tests a word between instructions.
+ *
+ * Single source interrupts are raised with raise() and cleared when the CPU
+ * accepts them. Multi source ones (ports) keep their flags in the device,
+ * which holds the line with setLevel() until the software clears them.
+ */
+class InterruptController
+{
+public:
+    static constexpr uint8_t NB_LINES = 32;
+    static constexpr uint8_t NO_LINE = 0xFF;
+    static constexpr uint32_t VECTOR_TABLE = 0xFFC0;
+
+    // Lines of the MSP430F2618 devices
+    static constexpr uint8_t LINE_PORT1 = 18;    // 0xFFE4
+    static constexpr uint8_t LINE_PORT2 = 19;    // 0xFFE6
+    static constexpr uint8_t LINE_WATCHDOG = 26; // 0xFFF4
+    static constexpr uint8_t LINE_NMI = 30;      // 0xFFFC
+
+    // Lines served whatever the GIE bit
+    static constexpr uint32_t NON_MASKABLE = 1u << LINE_NMI;
+
+    static uint32_t vectorAddress(uint8_t line)
+    {
+        return VECTOR_TABLE + 2 * line;
+    }
+
+    void raise(uint8_t line)
+    {
+        raised_ |= 1u << line;
+        update();
+    }
+    void setLevel(uint8_t line, bool active)
+    {
+        if (active)
+        {
+            levels_ |= 1u << line;
+        }
+        else
+        {
+            levels_ &= ~(1u << line);
+        }
+        update();
+    }
+    void clear(uint8_t line)
+    {
+        raised_ &= ~(1u << line);
+        levels_ &= ~(1u << line);
+        update();
+    }
+
+    uint32_t getPending() const { return pending_; }
+
+    // Highest priority line the CPU accepts with the given GIE bit, NO_LINE
+    // if none
+    uint8_t select(bool gie) const
+    {
+        uint32_t accepted = gie ? pending_ : (pending_ & NON_MASKABLE);
+
+        return accepted ? 31 - __builtin_clz(accepted) : NO_LINE;
+    }
+
+    // Called when the CPU enters the handler of line
+    void acknowledge(uint8_t line)
+    {
+        raised_ &= ~(1u << line);
+        update();
+    }
+
+    void saveState(SnapshotWriter &out) const
+    {
+        out.write(raised_);
+        out.write(levels_);
+    }
+    bool loadState(SnapshotReader &in)
+    {
+        uint32_t raised;
+        uint32_t levels;
+
+        if (!in.read(raised) || !in.read(levels))
+        {
+            return false;
+        }
+        raised_ = raised;
+        levels_ = levels;
+        update();
+        return true;
+    }
+    bool checkState(SnapshotReader &in) const
+    {
+        return in.skip(sizeof(raised_) + sizeof(levels_));
+    }
+
+private:
+    void update() { pending_ = raised_ | levels_; }
+
+    uint32_t pending_ = 0;
+    uint32_t raised_ = 0;
+    uint32_t levels_ = 0;
+};
@@ -6,17 +6,27 @@
 #include <sstream>
 #include <string.h>
 #include <string>
-#include <unistd.h>
+#include <thread>
 
 #include "DevicesManager.h"
 #include "MSP430.h"
+#include "MSP430Handlers.h"
 #include "MSP430InstructionHelper.h"
+#include "MSP430Trace.h"
 #include "Peripheral.h"
 
 using namespace std;
 
-MSP430::MSP430() : devicesManager_()
+MSP430::MSP430()
+    : devicesManager_(), executedInstructions_(0), cycles_(0),
+      jit_({&MSP430::jitExecuteOp, &MSP430::jitAccount}, jitLayout()),
+      backend_(BACKEND_INTERPRETER), stopRequested_(false),
+      flagsPending_(false)
 {
+    devicesManager_.setCodeWriteListener(this);
+    devicesManager_.getScheduler().setClock(&cycles_);
+    devicesManager_.getInputLog().setClock(&cycles_);
+
     // Initialize microcontroller
     resetRegisters();
 }
@@ -26,9 +36,41 @@ MSP430::~MSP430()
     // Destructor
 }
 
+/**
+ * Selects how blocks are executed.
+ *
+ * Returns false, keeping the current backend, if the JIT is not supported
+ * on this host or its code buffer cannot be mapped.
+ */
+bool MSP430::setExecutionBackend(EXECUTION_BACKEND backend)
+{
+    if ((backend == BACKEND_JIT) &&
+        (!MSP430Jit::isSupported() || !jit_.prepare()))
+    {
+        return false;
+    }
+    backend_ = backend;
+    return true;
+}
+
+/**
+ * Selects how fast run() executes: unthrottled, in real time or in real
+ * time multiplied by speed.
+ */
+void MSP430::setPacing(PACING_MODE mode, double speed)
+{
+    pacer_.setMode(mode, speed);
+}
+
+void MSP430::setCpuFrequency(uint64_t frequency)
+{
+    pacer_.setCpuFrequency(frequency);
+}
+
 void MSP430::resetRegisters()
 {
     memset(registers_, 0, sizeof(registers_));
+    flagsPending_ = false;
     setRegister(REG_IDX_SP, 0x2de0); // not necessary - initialized by FW
     //  through c_int00
     setRegister(REG_IDX_PC, 0x471c);
@@ -89,13 +131,13 @@ bool MSP430::parseHexFile(std::string filename, std::vector<uint8_t> &data)
         else if (recordType == 4)
         {
             int offset = std::stoi(line.substr(8, 4), nullptr, 16);
-            std::cout << "offset = " << offset << std::endl;
+            TRACE_INFO(TRACE_CPU, "offset = %d\n", offset);
             extAddr = (offset << 16);
             // assert(offset == 1);
         }
         else
         {
-            std::cout << "not managed record" << recordType << std::endl;
+            TRACE_ERROR(TRACE_CPU, "not managed record %d\n", recordType);
         }
     }
 
@@ -130,13 +172,20 @@ bool MSP430::loadROM(std::string filename)
         return false;
     }
 
+    // Check that the image was large enough to provide a reset vector
+    if (data.size() < 2)
+    {
+        std::cerr << "ROM file is too small." << std::endl;
+        return false;
+    }
+
+#if MSP430_TRACE_LEVEL >= TRACE_LEVEL_DEBUG
     // Dump the parsed data to a file for debugging
     dumpDataToFile(data, "dump.bin");
+#endif
 
-    // Check that the ROM file was large enough to provide a reset vector
-    if (data.size() < 2)
+    if (!loadImage(data.data(), data.size()))
     {
-        std::cerr << "ROM file is too small." << std::endl;
         return false;
     }
 
@@ -144,33 +193,163 @@ bool MSP430::loadROM(std::string filename)
     // regs.pc = (static_cast<uint32_t>(data[data.size() - 2]) << 8) |
     // data[data.size() - 1];
 
-    // Load the data into the emulator's memory
-    for (size_t i = 0; i < data.size(); i++)
-    {
-        // std::cout << "write " << i << std::endl;
-        devicesManager_.writeByte(i, data[i]);
-    }
     // regs.pc = devicesManager_.read(0x31FE, 2);
     // regs.pc = devicesManager_.read(0x3100, 2);
     // regs.pc = 0x3100;
     // regs.pc = devicesManager_.read(0xFFFE, 2);
     // setRegister(REG_IDX_PC, 0x9128);
-    std::cout << "vect reset addr=" << std::hex << getRegister(REG_IDX_PC)
-              << std::endl;
+    TRACE_INFO(TRACE_CPU, "vect reset addr=%X\n", getRegister(REG_IDX_PC));
     // regs.pc = devicesManager_.read(regs.pc, 2);
     // std::cout << "pc =" << std::hex << regs.pc << std::endl;
 
-    std::cout << "done " << data.size() << std::endl;
+    TRACE_INFO(TRACE_CPU, "done %zu\n", data.size());
+    return true;
+}
+
+bool MSP430::loadImage(const uint8_t *data, size_t size, uint32_t address)
+{
+    if (!DevicesManager::isValidRange(address, size))
+    {
+        TRACE_ERROR(TRACE_CPU, "image out of the bus %X+%zX\n", address,
+                    size);
+        return false;
+    }
+
+    // Load the data into the emulator's memory
+    for (size_t i = 0; i < size; i++)
+    {
+        devicesManager_.writeByte(address + i, data[i]);
+    }
+    return true;
+}
+
+// Marks the start of a snapshot ("M43X")
+static constexpr uint32_t SNAPSHOT_MAGIC = 0x5833344D;
+
+/**
+ * Saves the state of the machine into buffer, replacing its content.
+ *
+ * Returns false if a pending device event cannot be saved, or for an
+ * incremental snapshot without a previous full one.
+ */
+bool MSP430::saveSnapshot(std::vector<uint8_t> &buffer, bool incremental)
+{
+    SnapshotWriter out(buffer);
+
+    if (flagsPending_)
+    {
+        materializeFlags();
+    }
+
+    buffer.clear();
+    out.write(SNAPSHOT_MAGIC);
+    out.write(SNAPSHOT_VERSION);
+    out.write(registers_);
+    out.write(cycles_);
+    out.write(executedInstructions_);
+    return devicesManager_.saveState(out, incremental);
+}
+
+/**
+ * Restores a state saved by saveSnapshot().
+ *
+ * Restoring the last full snapshot, or an incremental one taken after it,
+ * only rewrites the memory pages written since. Only the decoded code of
+ * the pages whose content changes is dropped. Returns false on a snapshot
+ * of another version, a truncated or corrupt one or an incremental one of
+ * another checkpoint. The whole snapshot is checked before anything is
+ * restored, so the machine is then left untouched.
+ */
+bool MSP430::restoreSnapshot(const std::vector<uint8_t> &buffer)
+{
+    return restoreSnapshot(buffer.data(), buffer.size());
+}
+
+bool MSP430::restoreSnapshot(const uint8_t *data, size_t size)
+{
+    SnapshotReader in(data, size);
+    uint32_t magic;
+    uint32_t version;
+    uint32_t registers[NB_REGISTERS];
+    uint64_t cycles;
+    uint64_t executedInstructions;
+
+    if (!in.read(magic) || (magic != SNAPSHOT_MAGIC) || !in.read(version) ||
+        (version != SNAPSHOT_VERSION))
+    {
+        TRACE_ERROR(TRACE_CPU, "unsupported snapshot\n");
+        return false;
+    }
+
+    SnapshotReader check = in;
+    if (!check.read(registers) || !check.read(cycles) ||
+        !check.read(executedInstructions) ||
+        !devicesManager_.checkState(check) || !check.atEnd())
+    {
+        TRACE_ERROR(TRACE_CPU, "truncated snapshot\n");
+        return false;
+    }
+
+    // Checked above, cannot fail
+    in.read(registers);
+    in.read(cycles);
+    in.read(executedInstructions);
+    devicesManager_.loadState(in);
+
+    memcpy(registers_, registers, sizeof(registers_));
+    flagsPending_ = false;
+    cycles_ = cycles;
+    executedInstructions_ = executedInstructions;
     return true;
 }
 
+bool MSP430::saveSnapshotFile(const std::string &filename)
+{
+    std::vector<uint8_t> buffer;
+
+    if (!saveSnapshot(buffer))
+    {
+        return false;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    file.write((const char *) buffer.data(), buffer.size());
+    return file.good();
+}
+
+bool MSP430::restoreSnapshotFile(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+
+    if (!file)
+    {
+        TRACE_ERROR(TRACE_CPU, "cannot open snapshot %s\n", filename.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)),
+                                std::istreambuf_iterator<char>());
+    return restoreSnapshot(buffer);
+}
+
 uint32_t *MSP430::getRegPtr(uint8_t reg)
 {
     assert(reg < NB_REGISTERS);
+    if ((reg == REG_IDX_SR) && flagsPending_)
+    {
+        materializeFlags();
+    }
     return &registers_[reg];
 }
 
-void MSP430::regInc(uint8_t reg, uint32_t value) { registers_[reg] += value; }
+void MSP430::regInc(uint8_t reg, uint32_t value)
+{
+    if ((reg == REG_IDX_SR) && flagsPending_)
+    {
+        materializeFlags();
+    }
+    registers_[reg] += value;
+}
 
 void MSP430::regIncPc(void) { regInc(REG_IDX_PC, 2); }
 
@@ -178,12 +357,78 @@ void MSP430::regIncPc(void) { regInc(REG_IDX_PC, 2); }
 // operation being performed.
 void MSP430::setRegister(uint8_t reg, uint32_t value)
 {
-    cout << "**** set reg" << std::dec << reg + 0 << " : " << std::hex << value
-         << endl;
+    TRACE_DEBUG(TRACE_CPU, "set reg%d : %X\n", reg, value);
+    if (reg == REG_IDX_SR)
+    {
+        flagsPending_ = false;
+    }
     registers_[reg] = value;
 }
 
-uint32_t MSP430::getRegister(uint8_t reg) { return registers_[reg]; }
+uint32_t MSP430::getRegister(uint8_t reg)
+{
+    if ((reg == REG_IDX_SR) && flagsPending_)
+    {
+        materializeFlags();
+    }
+    return registers_[reg];
+}
+
+/**
+ * Computes the C, Z, N and V flags left pending by the last ALU operation
+ * and merges them into SR.
+ *
+ * The specialized handlers only record their operands and result; most of
+ * them are overwritten by the next operation before anything reads SR (a
+ * conditional jump, an SR operand, a push or a status dump).
+ */
+void MSP430::materializeFlags()
+{
+    const LazyFlags &flags = lazyFlags_;
+    uint32_t signBit = (flags.mask + 1) >> 1;
+    bool destSign = (flags.dst & signBit) != 0;
+    bool srcSign = (flags.src & signBit) != 0;
+    bool resultSign = (flags.result & signBit) != 0;
+    regStatus sr;
+
+    sr.value = registers_[REG_IDX_SR];
+    sr.status.negative = resultSign;
+
+    switch (flags.op)
+    {
+    case DECODE_HANDLER_ADD:
+    case DECODE_HANDLER_ADDC:
+        sr.status.zero = (flags.result & flags.mask) == 0;
+        sr.status.carry = (flags.result > flags.mask);
+        sr.status.overflow = (destSign == srcSign) && (destSign != resultSign);
+        break;
+
+    case DECODE_HANDLER_SUB:
+    case DECODE_HANDLER_SUBC:
+    case DECODE_HANDLER_CMP:
+        sr.status.zero = (flags.result & flags.mask) == 0;
+        sr.status.carry = (flags.dst >= flags.src);
+        sr.status.overflow = (destSign != srcSign) && (destSign != resultSign);
+        break;
+
+    case DECODE_HANDLER_DADD:
+        // Overflow is left unchanged
+        sr.status.zero = (flags.result & flags.mask) == 0;
+        sr.status.carry = (flags.result > flags.mask);
+        break;
+
+    default:
+        // AND, BIT and XOR: carry is set if the result is not zero
+        sr.status.zero = (flags.result == 0);
+        sr.status.carry = (flags.result != 0);
+        sr.status.overflow = (flags.op == DECODE_HANDLER_XOR) &&
+                             (flags.dst & 0x8000) && (flags.src & 0x8000);
+        break;
+    }
+
+    registers_[REG_IDX_SR] = sr.value;
+    flagsPending_ = false;
+}
 
 MSP430::regStatus MSP430::getStatusRegister()
 {
@@ -244,7 +489,8 @@ void MSP430::regDump()
 uint16_t MSP430::fetch()
 {
     uint16_t instruction = devicesManager_.readWord(getRegister(REG_IDX_PC));
-    printf("PC:%X instruction:%X\n", getRegister(REG_IDX_PC), instruction);
+    TRACE_DEBUG(TRACE_DECODE, "PC:%X instruction:%X\n",
+                getRegister(REG_IDX_PC), instruction);
 
     return instruction;
 }
@@ -276,6 +522,7 @@ void MSP430::decodeCoreInstruction(Instruction *instr, bool isExtended)
     instr->extended = isExtended;
     instr->minorOpcode = decodeMajorOpcode(rawInstruction);
     instr->format = opcodeToFormat(instr->minorOpcode);
+    instr->handler = opcodeToHandler(instr->minorOpcode);
     assert(instr->minorOpcode != 0x18 && instr->minorOpcode != 0x1C);
 
     uint8_t bwFlag = (rawInstruction & 0x0040) >> 6;
@@ -301,6 +548,21 @@ void MSP430::decodeCoreInstruction(Instruction *instr, bool isExtended)
         return;
     }
 
+    // Format II behind an extension word (RRCX, RRAX...): a single read,
+    // modify, write operand, only supported in register mode
+    if (instr->format == 2)
+    {
+        dst->axFlag = src->axFlag;
+        dst->reg = rawInstruction & 0xF;
+        dst->value = dst->reg;
+        dst->addrMode =
+            (dst->axFlag == 0) ? ADDR_MODE_REGISTER : ADDR_MODE_INVALID;
+        src->addrMode = ADDR_MODE_INVALID;
+        src->reg = 0;
+        src->value = 0;
+        return;
+    }
+
     // Set addressing modes for src and dst
     src->addrMode = asFlagToAddrMode(instr);
     dst->addrMode = adFlagToAddrMode(instr);
@@ -493,8 +755,8 @@ void MSP430::decodeInstructionMajorOpcode10(Instruction *instr)
     }
     else
     {
-        cout << "Unimplemented Maj:00 Minor:" << hex << instr->minorOpcode
-             << endl;
+        TRACE_ERROR(TRACE_DECODE, "Unimplemented Maj:00 Minor:%X\n",
+                    instr->minorOpcode);
         /* Not yet implemented */
         src->addrMode = ADDR_MODE_INVALID;
         assert(0);
@@ -537,17 +799,25 @@ void MSP430::decodeInstructionMajorOpcode14(Instruction *instr)
     }
 }
 
-void MSP430::updateInstructionValue(InstructionOperand *opd)
+/**
+ * Fetches the extension word of an operand, if its addressing mode has one.
+ *
+ * This is the static part of the operand decoding: it only depends on the
+ * instruction words, and the result can be cached with the instruction.
+ * The PC offset at which the operand must be resolved is recorded in
+ * opd->pcOffset.
+ *
+ * @param opd Operand to be decoded.
+ * @param pc Address of the instruction being decoded.
+ */
+void MSP430::fetchOperandExtension(InstructionOperand *opd, uint32_t pc)
 {
     assert(opd != nullptr);
-    uint32_t newValue = opd->value;
-    uint32_t mask = getInstructionMaskValue(opd);
-    uint8_t wordSizeBytes = wordSizeToBytes(opd->wordSize);
-
     bool fetchExtraData = false;
 
     switch (opd->addrMode)
     {
+    case ADDR_MODE_INVALID:
     case ADDR_MODE_REGISTER:
     case ADDR_MODE_INDIRECT_AUTOINCREMENT:
         break;
@@ -565,10 +835,27 @@ void MSP430::updateInstructionValue(InstructionOperand *opd)
     {
         regIncPc();
         opd->additionalRawInstruction = fetch();
-        newValue = (opd->value << 16) | opd->additionalRawInstruction;
-        opd->value = newValue;
+        opd->value = (opd->value << 16) | opd->additionalRawInstruction;
     }
 
+    opd->pcOffset = getRegister(REG_IDX_PC) - pc;
+}
+
+/**
+ * Resolves the value (and address) of an operand at execution time.
+ *
+ * The operand extension words must have been fetched by
+ * fetchOperandExtension() and the PC must point at the operand pcOffset.
+ *
+ * @param opd Operand to be resolved.
+ */
+void MSP430::updateInstructionValue(InstructionOperand *opd)
+{
+    assert(opd != nullptr);
+    uint32_t newValue = opd->value;
+    uint32_t mask = getInstructionMaskValue(opd);
+    uint8_t wordSizeBytes = wordSizeToBytes(opd->wordSize);
+
     switch (opd->addrMode)
     {
     case ADDR_MODE_REGISTER:
@@ -578,8 +865,8 @@ void MSP430::updateInstructionValue(InstructionOperand *opd)
     case ADDR_MODE_INDEXED:
         opd->address = getRegister(opd->reg) + opd->value;
         newValue = devicesManager_.read(opd->address, wordSizeBytes) & mask;
-        printf("read at @%X val=%X wz=%d\n", opd->address, newValue,
-               wordSizeBytes);
+        TRACE_DEBUG(TRACE_BUS, "read at @%X val=%X wz=%d\n", opd->address,
+                    newValue, wordSizeBytes);
         break;
 
     case ADDR_MODE_SYMBOLIC:
@@ -621,7 +908,7 @@ void MSP430::updateInstructionValue(InstructionOperand *opd)
     }
 }
 
-void MSP430::updateInstructionSource(InstructionOperand *src)
+void MSP430::decodeInstructionSource(InstructionOperand *src, uint32_t pc)
 {
     // handle case of source defined by constant generator
     if (((src->reg == 2) && ((src->axFlag > 1) && (src->axFlag <= 3))) ||
@@ -630,6 +917,29 @@ void MSP430::updateInstructionSource(InstructionOperand *src)
         src->value = getValueFromConstantGenerator(src->reg, src->axFlag);
         src->addrMode = ADDR_MODE_IMMEDIATE;
         src->usedConstantGenerator = true;
+        src->pcOffset = getRegister(REG_IDX_PC) - pc;
+        return;
+    }
+
+    fetchOperandExtension(src, pc);
+}
+
+void MSP430::decodeInstructionDestination(InstructionOperand *dst, uint32_t pc)
+{
+    assert((dst->addrMode == ADDR_MODE_INVALID) ||
+           (dst->addrMode == ADDR_MODE_REGISTER) ||
+           (dst->addrMode == ADDR_MODE_INDEXED) ||
+           (dst->addrMode == ADDR_MODE_SYMBOLIC) ||
+           (dst->addrMode == ADDR_MODE_ABSOLUTE));
+
+    fetchOperandExtension(dst, pc);
+}
+
+void MSP430::updateInstructionSource(InstructionOperand *src)
+{
+    // Constant generator values are resolved at decode time
+    if (src->usedConstantGenerator)
+    {
         return;
     }
 
@@ -652,103 +962,327 @@ void MSP430::updateInstructionDestination(InstructionOperand *dst)
         return;
     }
 
-    assert((dst->addrMode == ADDR_MODE_REGISTER) ||
-           (dst->addrMode == ADDR_MODE_INDEXED) ||
-           (dst->addrMode == ADDR_MODE_SYMBOLIC) ||
-           (dst->addrMode == ADDR_MODE_ABSOLUTE));
-
     updateInstructionValue(dst);
 }
 
 /**
- * Decodes an MSP430 instruction.
+ * Fetches the extension word of an operand decoded from the decode table.
+ *
+ * @param opd Operand to be decoded.
+ * @param entry Decode table description of the operand.
+ * @param pc Address of the instruction being decoded.
+ */
+void MSP430::fetchTableOperandExtension(InstructionOperand *opd,
+                                        const DecodeOperand &entry,
+                                        uint32_t pc)
+{
+    if (decodeOperandHasExtWord(entry, opd->wordSize))
+    {
+        regIncPc();
+        opd->additionalRawInstruction = fetch();
+        opd->value = (opd->value << 16) | opd->additionalRawInstruction;
+    }
+
+    opd->pcOffset = getRegister(REG_IDX_PC) - pc;
+}
+
+/**
+ * Tells if an instruction can be repeated (RPT): extended format I or II
+ * instructions whose operands are all in register mode. Only these have
+ * a repetition count and ZC flag in their extension word.
+ */
+static bool isRepeatable(const Instruction *instr)
+{
+    if ((instr->majorOpcode != MAJOR_OPCODE_18) &&
+        (instr->majorOpcode != MAJOR_OPCODE_1C))
+    {
+        return false;
+    }
+
+    if (instr->format == 2)
+    {
+        return instr->destination.axFlag == 0;
+    }
+    return (instr->format == 1) && (instr->source.axFlag == 0) &&
+           (instr->destination.axFlag == 0);
+}
+
+// Tells if an instruction reads the carry, which ZC then forces to 0
+static bool usesCarry(const Instruction *instr)
+{
+    if (instr->format == 2)
+    {
+        return ((instr->rawInstruction[1] >> 7) & 0x7) == 0; // RRC
+    }
+    return (instr->handler == DECODE_HANDLER_ADDC) ||
+           (instr->handler == DECODE_HANDLER_SUBC) ||
+           (instr->handler == DECODE_HANDLER_DADD);
+}
+
+static void setOperandFromTable(InstructionOperand *opd,
+                                const DecodeOperand &entry)
+{
+    opd->value = entry.value;
+    opd->reg = entry.reg;
+    opd->axFlag = entry.axFlag;
+    opd->wordSize = (enum WORD_SIZE) entry.wordSize;
+    opd->addrMode = (enum ADDRESSING_MODE) entry.addrMode;
+    opd->needUpdateValue = (entry.flags & DECODE_OPD_UPDATE_VALUE) != 0;
+    opd->usedConstantGenerator =
+        (entry.flags & DECODE_OPD_CONSTANT_GENERATOR) != 0;
+}
+
+/**
+ * Decodes the static part of the MSP430 instruction at PC.
+ *
+ * Opcode, format, handler, addressing modes, registers and constant
+ * generator values come from a single decodeTable lookup of the first word
+ * (of the core word for extended instructions). Only the extension words
+ * are fetched. Everything decoded here only depends on the instruction
+ * words, so the result can be kept in the decode cache. The PC is left on
+ * the last word of the instruction.
+ *
+ * Words the table can not decode (reserved or not yet implemented
+ * instructions, format II words behind an extension word) go through the
+ * reference decoder.
+ *
+ * @param instr Instruction structure to be filled.
+ */
+void MSP430::decodeStaticInstruction(Instruction *instr)
+{
+    InstructionOperand *src = &(instr->source);
+    InstructionOperand *dst = &(instr->destination);
+    uint32_t pc = getRegister(REG_IDX_PC);
+    uint16_t rawInstruction = fetch();
+    const DecodeEntry *entry = &decodeTable[rawInstruction];
+    uint16_t prefix = 0;
+
+    if (entry->kind == DECODE_KIND_PREFIX)
+    {
+        prefix = rawInstruction;
+        regIncPc();
+        rawInstruction = fetch();
+        entry = &decodeTable[rawInstruction];
+    }
+
+    if ((entry->kind == DECODE_KIND_INVALID) ||
+        (prefix && (entry->kind != DECODE_KIND_CORE)))
+    {
+        registers_[REG_IDX_PC] = pc;
+        decodeReferenceInstruction(instr);
+        return;
+    }
+
+    memset(instr, 0, sizeof(*instr));
+    instr->majorOpcode = entry->majorOpcode;
+    instr->minorOpcode = entry->minorOpcode;
+    instr->format = entry->format;
+    instr->extended = entry->extended;
+    instr->handler = entry->handler;
+    instr->cycles = entry->cycles;
+    instr->rawInstruction[0] = rawInstruction;
+    setOperandFromTable(src, entry->source);
+    setOperandFromTable(dst, entry->destination);
+
+    if (prefix)
+    {
+        instr->rawInstruction[0] = prefix;
+        instr->rawInstruction[1] = rawInstruction;
+        instr->majorOpcode = decodeTable[prefix].majorOpcode;
+        instr->extended = 1;
+        instr->zc = (prefix & 0x100) ? 1 : 0;
+        instr->cycles++; // extension word
+        src->wordSize = dst->wordSize = bwAlFlagToWordSize(
+            (rawInstruction >> 6) & 0x1, (prefix >> 6) & 0x1, true);
+
+        // Like the reference decoder, jumps take their offset from the
+        // first instruction word
+        if (instr->format == 3)
+        {
+            dst->value = prefix & 0x1FF;
+        }
+        else
+        {
+            dst->value = prefix & 0xF;
+            if (!src->usedConstantGenerator)
+            {
+                src->value = (src->addrMode == ADDR_MODE_INDEXED ||
+                              src->addrMode == ADDR_MODE_ABSOLUTE ||
+                              src->addrMode == ADDR_MODE_IMMEDIATE)
+                                 ? (prefix >> 7) & 0xF
+                                 : 0;
+            }
+        }
+    }
+
+    if (prefix && isRepeatable(instr) && !(prefix & 0x80))
+    {
+        instr->repetition = prefix & 0xF;
+    }
+
+    fetchTableOperandExtension(src, entry->source, pc);
+    fetchTableOperandExtension(dst, entry->destination, pc);
+
+    instr->size = getRegister(REG_IDX_PC) - pc + 2;
+}
+
+/**
+ * Decodes the static part of the MSP430 instruction at PC, without the
+ * decode table.
  *
  * The function determines the type of instruction based on its major opcode,
  * and then decodes it accordingly. Extended instructions are handled
- * separately. After decoding, the function updates the source and destination
- * values for the instruction.
+ * separately. This is the reference the decode table is checked against.
  *
- * @return The decoded instruction.
+ * @param instr Instruction structure to be filled.
  */
-Instruction MSP430::decodeInstruction(void)
+void MSP430::decodeReferenceInstruction(Instruction *instr)
 {
-    Instruction instr;
-
-    cout << "******* start decode instruction" << endl;
+    uint32_t pc = getRegister(REG_IDX_PC);
 
-    memset(&instr, 0, sizeof(instr));
-    instr.rawInstruction[0] = fetch();
-    instr.majorOpcode = decodeMajorOpcode(instr.rawInstruction[0]);
-    assert(instr.rawInstruction[0]);
+    memset(instr, 0, sizeof(*instr));
+    instr->rawInstruction[0] = fetch();
+    instr->majorOpcode = decodeMajorOpcode(instr->rawInstruction[0]);
+    assert(instr->rawInstruction[0]);
 
-    // std::cout << "MajorOpcode=" << std::hex << (int)instr.majorOpcode <<
+    // std::cout << "MajorOpcode=" << std::hex << (int)instr->majorOpcode <<
     // std::endl;
 
     // Handle extended instructions like MOVA, CMPA, ADDA, SUBA.
     // Referenced from p164 in MSP430 design manual.
-    if (instr.majorOpcode == MAJOR_OPCODE_00)
+    if (instr->majorOpcode == MAJOR_OPCODE_00)
     {
-        decodeInstructionMajorOpcode00(&instr);
+        decodeInstructionMajorOpcode00(instr);
     }
     // Handle RETI, CALLA, and some reserved codes. Also includes RRC, SWPB,
     // RRA, SXT. Referenced from p165 in MSP430 design manual.
-    else if (instr.majorOpcode == MAJOR_OPCODE_10)
+    else if (instr->majorOpcode == MAJOR_OPCODE_10)
     {
-        decodeInstructionMajorOpcode10(&instr);
+        decodeInstructionMajorOpcode10(instr);
     }
     // Handle POPM and PUSHM.
     // Referenced from p165 in MSP430 design manual.
-    else if (instr.majorOpcode == MAJOR_OPCODE_14)
+    else if (instr->majorOpcode == MAJOR_OPCODE_14)
     {
-        decodeInstructionMajorOpcode14(&instr);
+        decodeInstructionMajorOpcode14(instr);
     }
     // If the instruction is an extension word (0x1800 or 0x1900).
     // Referenced from p151 in MSP430 design manual.
-    else if ((instr.majorOpcode == MAJOR_OPCODE_18) ||
-             (instr.majorOpcode == MAJOR_OPCODE_1C))
+    else if ((instr->majorOpcode == MAJOR_OPCODE_18) ||
+             (instr->majorOpcode == MAJOR_OPCODE_1C))
     {
-        // check '#' repetition flag
-        if (instr.rawInstruction[0] & 0x80)
-        {
-            instr.repetition = instr.rawInstruction[0] & 0xF;
-            instr.repetition = getRegister(instr.repetition);
-        }
-        instr.zc = (instr.rawInstruction[0] & 0x100) ? 1 : 0;
+        instr->zc = (instr->rawInstruction[0] & 0x100) ? 1 : 0;
         // Update the source and destination values of the instruction depending
         // on the addressing mode.
         regIncPc();
-        instr.rawInstruction[1] = fetch();
-        decodeCoreInstruction(&instr, true);
+        instr->rawInstruction[1] = fetch();
+        decodeCoreInstruction(instr, true);
+        // '#' repetition flag clear: the repetition count is in the extension
+        // word, otherwise it is read from a register when the instruction is
+        // resolved.
+        if (isRepeatable(instr) && !(instr->rawInstruction[0] & 0x80))
+        {
+            instr->repetition = instr->rawInstruction[0] & 0xF;
+        }
     }
     // Handle non-extended format.
     else
     {
-        decodeCoreInstruction(&instr, false);
+        decodeCoreInstruction(instr, false);
     }
 
-    // Update the source and destination values of the instruction depending on
+    // Fetch the source and destination extension words depending on the
     // address mode.
-    updateInstructionSource(&(instr.source));
-    updateInstructionDestination(&(instr.destination));
-
-    printInstruction(&instr);
-    cout << "******* done decode instruction" << endl;
-    return instr;
+    decodeInstructionSource(&(instr->source), pc);
+    decodeInstructionDestination(&(instr->destination), pc);
+
+    instr->size = getRegister(REG_IDX_PC) - pc + 2;
+    instr->cycles = instructionCycles(
+        instr->majorOpcode, instr->format, instr->minorOpcode, instr->handler,
+        instr->source.addrMode, instr->source.usedConstantGenerator,
+        instr->source.value, instr->destination.addrMode,
+        instr->destination.reg);
 }
 
-void MSP430::handleType00(Instruction *instr) { assert(0); }
-
-void MSP430::handleTypeExt00(Instruction *instr)
+/**
+ * Resolves the dynamic part of a decoded instruction.
+ *
+ * Reads the repetition count register and the source and destination
+ * values, in the same order and with the same PC as a fresh decode would.
+ * The PC is left on the last word of the instruction.
+ *
+ * @param instr Instruction decoded by decodeStaticInstruction().
+ * @param pc Address of the instruction.
+ */
+void MSP430::resolveInstruction(Instruction *instr, uint32_t pc)
 {
-    switch (instr->minorOpcode)
+    if (isRepeatable(instr) && (instr->rawInstruction[0] & 0x80))
     {
-    case MINOR_EXT00_MOVA_INDIRECT_REGISTER:
-    case MINOR_EXT00_MOVA_INDIRECT_AUTOINCREMENT:
-    case MINOR_EXT00_MOVA_ABSOLUTE_SOURCE:
-    case MINOR_EXT00_MOVA_INDEXED_SOURCE:
-    case MINOR_EXT00_MOVA_ABSOLUTE_DESINTATION:
-    case MINOR_EXT00_MOVA_INDEXED_DESTINATION:
-    case MINOR_EXT00_MOVA_IMMEDIATE:
+        instr->repetition = getRegister(instr->rawInstruction[0] & 0xF);
+    }
+
+    registers_[REG_IDX_PC] = pc + instr->source.pcOffset;
+    updateInstructionSource(&(instr->source));
+    registers_[REG_IDX_PC] = pc + instr->destination.pcOffset;
+    updateInstructionDestination(&(instr->destination));
+    registers_[REG_IDX_PC] = pc + instr->size - 2;
+}
+
+/**
+ * Decodes an MSP430 instruction.
+ *
+ * The static part of the instruction is taken from the decode cache, or
+ * decoded and cached on a miss. The source and destination values are then
+ * resolved for the current machine state.
+ *
+ * @return The decoded instruction.
+ */
+Instruction MSP430::decodeInstruction(void)
+{
+    uint32_t pc = getRegister(REG_IDX_PC);
+    Instruction instr;
+
+    TRACE_DEBUG(TRACE_DECODE, "start decode instruction\n");
+
+    const Instruction *cached = decodeCache_.lookup(pc);
+    if (cached != nullptr)
+    {
+        instr = *cached;
+    }
+    else
+    {
+        decodeStaticInstruction(&instr);
+        decodeCache_.insert(pc, instr);
+        devicesManager_.markCodePage(pc);
+        devicesManager_.markCodePage(pc + instr.size - 1);
+    }
+
+    resolveInstruction(&instr, pc);
+
+    printInstruction(&instr);
+    TRACE_DEBUG(TRACE_DECODE, "done decode instruction\n");
+    return instr;
+}
+
+void MSP430::onCodeWrite(uint32_t address, uint32_t nbBytes)
+{
+    decodeCache_.invalidate(address, nbBytes);
+    blockCache_.invalidate(address, nbBytes);
+}
+
+void MSP430::handleType00(Instruction *instr) { assert(0); }
+
+void MSP430::handleTypeExt00(Instruction *instr)
+{
+    switch (instr->minorOpcode)
+    {
+    case MINOR_EXT00_MOVA_INDIRECT_REGISTER:
+    case MINOR_EXT00_MOVA_INDIRECT_AUTOINCREMENT:
+    case MINOR_EXT00_MOVA_ABSOLUTE_SOURCE:
+    case MINOR_EXT00_MOVA_INDEXED_SOURCE:
+    case MINOR_EXT00_MOVA_ABSOLUTE_DESINTATION:
+    case MINOR_EXT00_MOVA_INDEXED_DESTINATION:
+    case MINOR_EXT00_MOVA_IMMEDIATE:
     case MINOR_EXT00_MOVA_REGISTER:
         runMovInstruction(instr);
         break;
@@ -778,7 +1312,28 @@ void MSP430::handleTypeExt00(Instruction *instr)
     };
 }
 
-void MSP430::handleType10(Instruction *instr) { assert(0); }
+/**
+ * Executes a format II instruction behind an extension word.
+ */
+void MSP430::handleType10(Instruction *instr)
+{
+    // Only register mode operands are decoded
+    assert(instr->destination.addrMode == ADDR_MODE_REGISTER);
+
+    switch ((instr->rawInstruction[1] >> 7) & 0x7)
+    {
+    case 0:
+        runRrcInstruction(instr);
+        break;
+    case 2:
+        runRraInstruction(instr);
+        break;
+    default:
+        // SWPBX, SXTX, PUSHX, CALL and RETI are not yet implemented
+        assert(0);
+        break;
+    }
+}
 
 void MSP430::handleTypeExt10(Instruction *instr)
 {
@@ -786,8 +1341,17 @@ void MSP430::handleTypeExt10(Instruction *instr)
     {
     /* RETI */
     case MINOR_EXT10_RETI:
-        assert(0);
+    {
+        uint32_t sp = getRegister(REG_IDX_SP);
+        uint16_t sr = devicesManager_.readWord(sp);
+        uint16_t pc = devicesManager_.readWord(sp + 2);
+
+        // PC bits 19:16 were saved in the top of the status register word
+        setRegister(REG_IDX_SR, sr & 0x0FFF);
+        setRegister(REG_IDX_SP, sp + 4);
+        setRegister(REG_IDX_PC, ((sr & 0xF000) << 4) | pc);
         break;
+    }
 
     /* CALLA */
     case MINOR_EXT10_CALLA_REGISTER:
@@ -806,7 +1370,7 @@ void MSP430::handleTypeExt10(Instruction *instr)
         devicesManager_.writeWord(getRegister(REG_IDX_SP),
                                   getRegister(REG_IDX_PC) & 0xFFFF);
         setRegister(REG_IDX_PC, instr->source.value);
-        printf("CALLA #imm20 %X\n", getRegister(REG_IDX_PC));
+        TRACE_DEBUG(TRACE_CPU, "CALLA #imm20 %X\n", getRegister(REG_IDX_PC));
         break;
 
     /* Reserved */
@@ -830,7 +1394,7 @@ void MSP430::runPushPopInstruction(Instruction *instr)
     case 0x14:
     /* PUSHM.W */
     case 0x15:
-        printf("PUSHM.X %X %X\n", nMinus1, dst);
+        TRACE_DEBUG(TRACE_CPU, "PUSHM.X %X %X\n", nMinus1, dst);
 
         // Push the n registers onto the stack
         for (uint32_t i = 0; i <= nMinus1; ++i)
@@ -845,8 +1409,8 @@ void MSP430::runPushPopInstruction(Instruction *instr)
             // Push the value onto the stack
             devicesManager_.write(getRegister(REG_IDX_SP), reg_value,
                                   wordSizeInBytes);
-            printf("wrote reg:%d at %X: %X (%d)\n", i, getRegister(REG_IDX_SP),
-                   reg_value, wordSizeInBytes);
+            TRACE_DEBUG(TRACE_CPU, "wrote reg:%d at %X: %X (%d)\n", i,
+                        getRegister(REG_IDX_SP), reg_value, wordSizeInBytes);
         }
         regIncPc();
         break;
@@ -855,7 +1419,7 @@ void MSP430::runPushPopInstruction(Instruction *instr)
     case 0x16:
     /* POPM.W */
     case 0x17:
-        printf("POPM.X %X %X\n", nMinus1, dst);
+        TRACE_DEBUG(TRACE_CPU, "POPM.X %X %X\n", nMinus1, dst);
         // Pop the n registers from the stack
         for (uint32_t i = 0; i <= nMinus1; ++i)
         {
@@ -863,8 +1427,8 @@ void MSP430::runPushPopInstruction(Instruction *instr)
             uint32_t reg_value =
                 devicesManager_.read(getRegister(REG_IDX_SP), wordSizeInBytes);
 
-            printf("read reg:%d from %X: %X (%d)\n", i, getRegister(REG_IDX_SP),
-                   reg_value, wordSizeInBytes);
+            TRACE_DEBUG(TRACE_CPU, "read reg:%d from %X: %X (%d)\n", i,
+                        getRegister(REG_IDX_SP), reg_value, wordSizeInBytes);
 
             // Update the register
             setRegister(dst + i, reg_value);
@@ -925,7 +1489,7 @@ void MSP430::instructionWrite(Instruction *instr, uint32_t value,
 
     if (dst->addrMode == ADDR_MODE_REGISTER)
     {
-        printf("write %X to reg %d\n", value, dst->reg);
+        TRACE_DEBUG(TRACE_CPU, "write %X to reg %d\n", value, dst->reg);
         setRegister(dst->reg, value);
         if (dst->reg == REG_IDX_PC)
             updatedRegPc = true;
@@ -936,7 +1500,7 @@ void MSP430::instructionWrite(Instruction *instr, uint32_t value,
         devicesManager_.write(dst->address, value, nbBytes);
     }
 
-    printf("%s %X -> dest\n", str.c_str(), value);
+    TRACE_DEBUG(TRACE_CPU, "%s %X -> dest\n", str.c_str(), value);
     // if (updatedRegPc == false || alwaysIncPc)
 
     if (alwaysIncPc || (updatedRegPc == false))
@@ -947,48 +1511,34 @@ void MSP430::instructionWrite(Instruction *instr, uint32_t value,
 
 void MSP430::runRrcInstruction(Instruction *instr)
 {
+    InstructionOperand *dst = &(instr->destination);
     regStatus sr = getStatusRegister();
-    uint32_t dstValue = getRegister(instr->destination.reg);
+    uint32_t signMask = getInstructionSignMask(dst);
+    uint32_t result = (dst->value >> 1) | (sr.status.carry ? signMask : 0);
 
-    if (instr->destination.wordSize == BYTE)
-    {
-        uint8_t oldCarry = sr.status.carry;
-        sr.status.carry =
-            dstValue & 0x01; // Update carry with LSB of the destination
-        dstValue = (dstValue >> 1) | (oldCarry << 7); // 7 for BYTE
-    }
-    else
-    {
-        uint8_t oldCarry = sr.status.carry;
-        sr.status.carry =
-            dstValue & 0x0001; // Update carry with LSB of the destination
-        dstValue = (dstValue >> 1) | (oldCarry << 15); // 15 for WORD
-    }
+    instructionWrite(instr, result, "RRC");
 
-    setRegister(instr->destination.reg, dstValue);
+    regSetCarry(sr, dst->value & 0x1);
+    regSetNegative(sr, result & signMask);
+    regSetZero(sr, result);
+    regSetOverflow(sr, false);
     setRegister(REG_IDX_SR, sr.value);
-    regIncPc();
-    printf("Rrc\n");
 }
 
 void MSP430::runRraInstruction(Instruction *instr)
 {
-    uint32_t dstValue = getRegister(instr->destination.reg);
+    InstructionOperand *dst = &(instr->destination);
+    regStatus sr = getStatusRegister();
+    uint32_t signMask = getInstructionSignMask(dst);
+    uint32_t result = (dst->value >> 1) | (dst->value & signMask);
 
-    if (instr->destination.wordSize == BYTE)
-    {
-        uint32_t signBit = dstValue & 0x80; // Get the 8th bit for BYTE
-        dstValue = (dstValue >> 1) | signBit;
-    }
-    else
-    {
-        uint32_t signBit = dstValue & 0x8000; // Get the MSB for WORD
-        dstValue = (dstValue >> 1) | signBit;
-    }
+    instructionWrite(instr, result, "RRA");
 
-    setRegister(instr->destination.reg, dstValue);
-    regIncPc();
-    printf("Rra\n");
+    regSetCarry(sr, dst->value & 0x1);
+    regSetNegative(sr, result & signMask);
+    regSetZero(sr, result);
+    regSetOverflow(sr, false);
+    setRegister(REG_IDX_SR, sr.value);
 }
 
 void MSP430::runSwpbInstruction(Instruction *instr)
@@ -1004,7 +1554,7 @@ void MSP430::runSwpbInstruction(Instruction *instr)
     }
 
     regIncPc();
-    printf("Swp\n");
+    TRACE_DEBUG(TRACE_CPU, "Swp\n");
 }
 
 void MSP430::runSxtInstruction(Instruction *instr)
@@ -1025,7 +1575,7 @@ void MSP430::runSxtInstruction(Instruction *instr)
 
     setRegister(instr->destination.reg, dstValue);
     regIncPc();
-    printf("Sxt\n");
+    TRACE_DEBUG(TRACE_CPU, "Sxt\n");
 }
 
 bool MSP430::checkCondition(uint8_t opcode)
@@ -1060,37 +1610,17 @@ bool MSP430::checkCondition(uint8_t opcode)
 
 void MSP430::runJumpInstruction(Instruction *instr, uint8_t opcode)
 {
-    // InstructionOperand *dst = &(instr->destination);
-    int offset;
-
     if (checkCondition(opcode))
     {
-        // dst->value is a 10-bit value from the instruction, so we mask it
-        // with 0x3FF to ensure it's indeed 10 bits
-        uint16_t rawOffset = instr->rawInstruction[0] & 0x3FF;
-
-        // Check if the most significant bit (bit 9) is set
-        if (rawOffset & 0x200)
-        {
-            // This is a negative offset; convert it to a signed 10-bit integer
-            offset = rawOffset - 0x400; // Equivalent to taking two's complement
-        }
-        else
-        {
-            // This is a positive offset
-            offset = rawOffset;
-        }
-
-        // Convert the 10-bit offset to a byte offset and add 2
-        offset = (offset * 2) + 2;
-        printf("JUMP %X\n", offset);
+        int offset = jumpOffset(instr->rawInstruction[0]);
+        TRACE_DEBUG(TRACE_CPU, "JUMP %X\n", offset);
 
         // Update the program counter
         setRegister(REG_IDX_PC, getRegister(REG_IDX_PC) + offset);
     }
     else
     {
-        printf("JUMP continue\n");
+        TRACE_DEBUG(TRACE_CPU, "JUMP continue\n");
         // Move to the next instruction (increment PC)
         regIncPc();
     }
@@ -1103,7 +1633,7 @@ void MSP430::runMovInstruction(Instruction *instr)
         instr->source.addrMode == ADDR_MODE_IMMEDIATE &&
         instr->destination.addrMode == ADDR_MODE_REGISTER)
     {
-        printf("NOP\n");
+        TRACE_DEBUG(TRACE_CPU, "NOP\n");
         return;
     }
     instructionWrite(instr, instr->source.value, "MOV", false);
@@ -1144,7 +1674,7 @@ void MSP430::runAddInstruction(Instruction *instr, bool isAddc)
     sr.status.overflow = (destSign == srcSign) && (destSign != resultSign);
 
     setRegister(REG_IDX_SR, sr.value);
-    printf("ADD\n");
+    TRACE_DEBUG(TRACE_CPU, "ADD\n");
 }
 
 /**
@@ -1231,7 +1761,7 @@ void MSP430::runRrRlInstruction(Instruction *instr)
     regSetOverflow(sr, false);
 
     setRegister(REG_IDX_SR, sr.value);
-    printf("RlRr\n");
+    TRACE_DEBUG(TRACE_CPU, "RlRr\n");
 }
 
 void MSP430::runSubInstruction(Instruction *instr, bool isSubc)
@@ -1248,7 +1778,8 @@ void MSP430::runSubInstruction(Instruction *instr, bool isSubc)
     }
     else
     {
-        printf("sub %X -%X\n", instr->destination.value, instr->source.value);
+        TRACE_DEBUG(TRACE_CPU, "sub %X -%X\n", instr->destination.value,
+                    instr->source.value);
     }
 
     instructionWrite(instr, value, isSubc ? "SUBC" : "SUB");
@@ -1272,7 +1803,7 @@ void MSP430::runSubInstruction(Instruction *instr, bool isSubc)
     sr.status.overflow = (destSign != srcSign) && (destSign != resultSign);
 
     setRegister(REG_IDX_SR, sr.value);
-    printf("Sub");
+    TRACE_DEBUG(TRACE_CPU, "Sub\n");
 }
 
 void MSP430::runCmpInstruction(Instruction *instr)
@@ -1301,7 +1832,7 @@ void MSP430::runCmpInstruction(Instruction *instr)
     sr.status.overflow = (destSign != srcSign) && (destSign != resultSign);
 
     setRegister(REG_IDX_SR, sr.value);
-    printf("Cmp\n");
+    TRACE_DEBUG(TRACE_CPU, "Cmp\n");
 
     // Note: We don't modify the destination operand for CMP instruction
 
@@ -1360,7 +1891,7 @@ void MSP430::runDaddInstruction(Instruction *instr)
     instructionWrite(instr, value, "DADD");
 
     setRegister(REG_IDX_SR, sr.value);
-    printf("Dadd\n");
+    TRACE_DEBUG(TRACE_CPU, "Dadd\n");
 }
 
 void MSP430::regUpdateStatusForLogicalOp(uint32_t result, uint32_t signMask,
@@ -1369,7 +1900,7 @@ void MSP430::regUpdateStatusForLogicalOp(uint32_t result, uint32_t signMask,
 {
     regStatus sr = getStatusRegister();
 
-    printf("result=%X\n", result);
+    TRACE_DEBUG(TRACE_CPU, "result=%X\n", result);
     regSetZero(sr, result);
     regSetNegative(sr, result & signMask);
     regSetCarry(sr, result != 0); // Carry is set if result is not zero
@@ -1386,10 +1917,9 @@ void MSP430::regUpdateStatusForLogicalOp(uint32_t result, uint32_t signMask,
 
 // Function to execute a logical operation and (optionally) update the status
 // register
-void MSP430::executeLogicalOp(Instruction *instr,
-                              std::function<uint32_t(uint32_t, uint32_t)> op,
-                              bool updateStatus, uint32_t operand1,
-                              uint32_t operand2, bool isXor)
+template <typename Op>
+void MSP430::executeLogicalOp(Instruction *instr, Op op, bool updateStatus,
+                              uint32_t operand1, uint32_t operand2, bool isXor)
 {
     uint32_t signMask = getInstructionSignMask(&instr->source);
     uint32_t result = op(instr->destination.value, instr->source.value);
@@ -1404,28 +1934,28 @@ void MSP430::executeLogicalOp(Instruction *instr,
 
 void MSP430::runBitInstruction(Instruction *instr)
 {
-    printf("Bit\n");
+    TRACE_DEBUG(TRACE_CPU, "Bit\n");
     executeLogicalOp(
         instr, [](uint32_t dst, uint32_t src) { return dst & src; }, true);
 }
 
 void MSP430::runBicInstruction(Instruction *instr)
 {
-    printf("Bic\n");
+    TRACE_DEBUG(TRACE_CPU, "Bic\n");
     executeLogicalOp(
         instr, [](uint32_t dst, uint32_t src) { return dst & ~src; }, false);
 }
 
 void MSP430::runBisInstruction(Instruction *instr)
 {
-    printf("Bis\n");
+    TRACE_DEBUG(TRACE_CPU, "Bis\n");
     executeLogicalOp(
         instr, [](uint32_t dst, uint32_t src) { return dst | src; }, false);
 }
 
 void MSP430::runXorInstruction(Instruction *instr)
 {
-    printf("Xor\n");
+    TRACE_DEBUG(TRACE_CPU, "Xor\n");
     executeLogicalOp(
         instr, [](uint32_t dst, uint32_t src) { return dst ^ src; }, true,
         instr->destination.value, instr->source.value,
@@ -1434,7 +1964,7 @@ void MSP430::runXorInstruction(Instruction *instr)
 
 void MSP430::runAndInstruction(Instruction *instr)
 {
-    printf("And\n");
+    TRACE_DEBUG(TRACE_CPU, "And\n");
     executeLogicalOp(
         instr, [](uint32_t dst, uint32_t src) { return dst & src; }, true);
 }
@@ -1545,60 +2075,640 @@ void MSP430::runOneInstruction(Instruction *instr)
     }
 }
 
-const unsigned int SLEEP_DURATION = 100000; // 100ms
+/**
+ * Selects the execute handler of a decoded instruction.
+ *
+ * This is the dispatch of runOneInstruction(), done once when a block is
+ * built so that executing a block op is a single indirect call.
+ */
+OpHandler MSP430::selectHandler(const Instruction &instr)
+{
+    // Indexed by the decode table handler id (enum DECODE_HANDLER)
+    static const OpHandler handlers[NB_DECODE_HANDLERS] = {
+        [](MSP430 *cpu, Instruction *i) { cpu->runOneInstruction(i); },
+        [](MSP430 *cpu, Instruction *i)
+        { cpu->runJumpInstruction(i, i->minorOpcode); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runMovInstruction(i); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runAddInstruction(i, false); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runAddInstruction(i, true); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runSubInstruction(i, true); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runSubInstruction(i, false); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runCmpInstruction(i); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runDaddInstruction(i); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runBitInstruction(i); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runBicInstruction(i); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runBisInstruction(i); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runXorInstruction(i); },
+        [](MSP430 *cpu, Instruction *i) { cpu->runAndInstruction(i); },
+    };
+
+    // Remaining extended instructions and unsupported opcodes go through the
+    // generic dispatch, which asserts on the latter.
+    if (instr.extended && (instr.majorOpcode != MAJOR_OPCODE_18))
+    {
+        return handlers[DECODE_HANDLER_GENERIC];
+    }
+
+    OpHandler handler = MSP430Handlers::select(instr);
+    return (handler != nullptr) ? handler : handlers[instr.handler];
+}
 
-void MSP430::run()
+/**
+ * Decodes the basic block starting at pc.
+ *
+ * The PC is restored once the block is decoded.
+ */
+Block *MSP430::buildBlock(uint32_t pc)
 {
-    Instruction instr;
+    auto block = std::make_unique<Block>();
+    uint32_t savedPc = getRegister(REG_IDX_PC);
+    uint32_t opPc = pc;
+
+    block->startPc = pc;
+    block->takenPc = Block::NO_TARGET;
+    block->maxCycles = 0;
+    block->maxInstructions = 0;
+
+    while (true)
+    {
+        BlockOp op;
+
+        registers_[REG_IDX_PC] = opPc;
+        decodeStaticInstruction(&op.instr);
+        op.handler = selectHandler(op.instr);
+
+        // Keep blocks within MSP430BlockCache::MAX_BLOCK_SIZE
+        if (!block->ops.empty() &&
+            (opPc + op.instr.size - pc > MSP430BlockCache::MAX_BLOCK_SIZE))
+        {
+            break;
+        }
+
+        devicesManager_.markCodePage(opPc);
+        devicesManager_.markCodePage(opPc + op.instr.size - 1);
+        block->ops.push_back(op);
+
+        // An RPT Rn count is only known at run time: up to 16 runs
+        uint32_t runs = op.instr.repetition + 1;
+        if (isRepeatable(&op.instr) && (op.instr.rawInstruction[0] & 0x80))
+        {
+            runs = 16;
+        }
+        block->maxCycles += runs * op.instr.cycles;
+        block->maxInstructions += runs;
+
+        if (op.instr.format == 3)
+        {
+            block->takenPc = opPc + jumpOffset(op.instr.rawInstruction[0]);
+        }
+        opPc += op.instr.size;
+
+        if (instructionEndsBlock(op.instr) ||
+            (block->ops.size() >= MSP430BlockCache::MAX_BLOCK_OPS))
+        {
+            break;
+        }
+    }
+
+    block->endPc = opPc;
+    registers_[REG_IDX_PC] = savedPc;
+    return blockCache_.insert(std::move(block));
+}
+
+/**
+ * Returns the block to run at pc, following the chain links of the
+ * previously executed block when possible.
+ */
+Block *MSP430::nextBlock(Block *previous, uint32_t pc)
+{
+    int edge = -1;
+
+    if ((previous != nullptr) && previous->valid)
+    {
+        if (pc == previous->takenPc)
+        {
+            edge = Block::EDGE_TAKEN;
+        }
+        else if (pc == previous->endPc)
+        {
+            edge = Block::EDGE_NOT_TAKEN;
+        }
+
+        if (edge >= 0)
+        {
+            Block *next = blockCache_.getLink(previous, edge);
+            if (next != nullptr)
+            {
+                return next;
+            }
+        }
+    }
+
+    Block *block = blockCache_.lookup(pc);
+    if (block == nullptr)
+    {
+        block = buildBlock(pc);
+    }
+
+    if (edge >= 0)
+    {
+        blockCache_.setLink(previous, edge, block);
+    }
+    return block;
+}
+
+/**
+ * Clears the carry before an instruction with the ZC bit set (RRUX and the
+ * repeated ADDCX, SUBCX, DADDX), so that it is run with a zero carry in.
+ */
+void MSP430::applyZeroCarry(const Instruction *instr)
+{
+    if (instr->zc && usesCarry(instr))
+    {
+        setRegister(REG_IDX_SR, getRegister(REG_IDX_SR) & ~1u);
+    }
+}
+
+/**
+ * Runs the remaining iterations of an RPT prefixed instruction.
+ *
+ * Only register operands can be repeated, so the instruction is not decoded
+ * again: its operands are reloaded from their registers before each run. The
+ * extension word is fetched once, each iteration then takes one cycle less
+ * than the first.
+ *
+ * @param instr Instruction resolved for its first run.
+ * @param handler Pre-bound handler of the instruction.
+ * @param pc Address of the instruction.
+ */
+void MSP430::runRepetitions(Instruction *instr, OpHandler handler,
+                            uint32_t pc)
+{
+    uint32_t count = instr->repetition;
 
-    // Initialize instr to zero
-    memset(&instr, 0, sizeof(Instruction));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        registers_[REG_IDX_PC] = pc + instr->size - 2;
+        updateInstructionSource(&(instr->source));
+        updateInstructionDestination(&(instr->destination));
+        applyZeroCarry(instr);
+        handler(this, instr);
+    }
+
+    executedInstructions_ += count;
+    cycles_ += count * (instr->cycles - 1);
+}
 
-    while (true) // Run until the program is manually stopped
+/**
+ * Runs one op of a block.
+ *
+ * The op is resolved against the current machine state and dispatched to
+ * its pre-bound handler. Returns false if execution must leave the block:
+ * the op invalidated it, or an interrupt is to be taken.
+ */
+bool MSP430::executeBlockOp(Block *block, BlockOp &op)
+{
+    uint32_t initialPC = getRegister(REG_IDX_PC);
+    Instruction instr = op.instr;
+
+    // Compiled out with the CPU traces, it would otherwise materialize the
+    // lazy flags on every instruction
+    if constexpr (MSP430Trace::isCompiled(TRACE_LEVEL_DEBUG))
     {
-        // Store initial PC for repetition
-        uint32_t initialPC = getRegister(REG_IDX_PC);
+        if (MSP430Trace::isEnabled(TRACE_CPU))
+        {
+            displayDebugInformation();
+        }
+    }
+
+    resolveInstruction(&instr, initialPC);
+    applyZeroCarry(&instr);
+    op.handler(this, &instr);
+    executedInstructions_++;
+    cycles_ += instr.cycles;
 
-        // Display debug information
-        displayDebugInformation();
+    if (instr.repetition)
+    {
+        TRACE_DEBUG(TRACE_CPU, "Repetition %d\n", instr.repetition);
+        runRepetitions(&instr, op.handler, initialPC);
+    }
 
-        // Reset repetition counter
-        int currentRepetition = 0;
+    devicesManager_.runEvents(cycles_);
+    return block->valid && !isInterruptReady();
+}
 
-        do
+/**
+ * Runs the instructions of a block, leaving it early if one of its
+ * instructions invalidated it.
+ */
+void MSP430::runBlock(Block *block)
+{
+    for (BlockOp &op : block->ops)
+    {
+        if (!executeBlockOp(block, op))
         {
-            // Decode the next instruction
-            instr = decodeInstruction();
+            break;
+        }
+    }
+}
 
-            // Debug output for repetition
-            printf("Repetition %d/%d\n", currentRepetition, instr.repetition);
+// Offsets from the register file of the state used by translated code
+JitLayout MSP430::jitLayout()
+{
+    const uint8_t *base = (const uint8_t *) registers_;
+    auto offset = [base](const void *field)
+    { return (int32_t) ((const uint8_t *) field - base); };
+
+    return {offset(devicesManager_.getPageReadData()),
+            offset(devicesManager_.getPageWriteData()),
+            offset(&lazyFlags_.op),
+            offset(&lazyFlags_.result),
+            offset(&lazyFlags_.src),
+            offset(&lazyFlags_.dst),
+            offset(&lazyFlags_.mask),
+            offset(&flagsPending_),
+            offset(&cycles_),
+            offset(devicesManager_.getScheduler().getNextEventTimePtr())};
+}
 
-            // Execute the instruction
-            runOneInstruction(&instr);
+bool MSP430::jitExecuteOp(MSP430 *cpu, Block *block, BlockOp *op)
+{
+    return cpu->executeBlockOp(block, *op);
+}
 
-            // Restore PC for further repetitions
-            if (currentRepetition < instr.repetition)
+bool MSP430::jitAccount(MSP430 *cpu, uint32_t count, uint32_t cycles)
+{
+    cpu->executedInstructions_ += count;
+    cpu->cycles_ += cycles;
+    cpu->devicesManager_.runEvents(cpu->cycles_);
+    return !cpu->isInterruptReady();
+}
+
+/**
+ * Runs a block with the selected backend.
+ *
+ * With the JIT backend, blocks are translated once they have run
+ * MSP430Jit::HOT_THRESHOLD times. A full code buffer drops every
+ * translation; this is safe here since no translated code is running. If
+ * the host refuses to map or protect the code buffer, the interpreter
+ * takes over for good.
+ */
+void MSP430::executeBlock(Block *block)
+{
+    if (backend_ == BACKEND_JIT)
+    {
+        if ((block->native == nullptr) &&
+            (++block->execCount >= MSP430Jit::HOT_THRESHOLD))
+        {
+            block->native = jit_.compile(block);
+            if ((block->native == nullptr) && !jit_.hasFailed())
             {
-                setRegister(REG_IDX_PC, initialPC);
+                blockCache_.clearNativeCode();
+                jit_.reset();
+                block->native = jit_.compile(block);
             }
+            if (jit_.hasFailed())
+            {
+                TRACE_ERROR(TRACE_CPU, "JIT disabled, no executable memory\n");
+                blockCache_.clearNativeCode();
+                backend_ = BACKEND_INTERPRETER;
+                runBlock(block);
+                return;
+            }
+        }
+
+        if (block->native != nullptr)
+        {
+            block->native(registers_, this);
+            return;
+        }
+    }
+
+    runBlock(block);
+}
+
+/**
+ * Lets simulated time pass while the CPU is off (low power modes).
+ *
+ * Nothing is fetched: time jumps to the next device event. With no event
+ * pending, time moves by IDLE_CYCLES steps; at maximum speed the host also
+ * sleeps, since only the outside world can then change the device state.
+ */
+void MSP430::idle(uint64_t limit)
+{
+    uint64_t next = devicesManager_.getNextEventTime();
+
+    if (next == EventScheduler::NO_EVENT)
+    {
+        next = cycles_ + IDLE_CYCLES;
+        if (pacer_.getMode() == PACING_MAX_SPEED)
+        {
+            std::this_thread::sleep_for(
+                std::chrono::microseconds(MSP430Pacer::QUANTUM_US));
+        }
+    }
+
+    if (next > limit)
+    {
+        next = limit;
+    }
+    if (next > cycles_)
+    {
+        cycles_ = next;
+    }
+    devicesManager_.runEvents(cycles_);
+}
+
+/**
+ * Enters the handler of the highest priority interrupt accepted.
+ *
+ * PC then SR are pushed, PC bits 19:16 in the top of the SR word, and SR is
+ * cleared but for SCG0: the CPU leaves any low power mode, which RETI
+ * restores unless the handler changed the saved SR.
+ */
+void MSP430::enterInterrupt()
+{
+    InterruptController &interrupts = devicesManager_.getInterrupts();
+    uint32_t sr = getRegister(REG_IDX_SR);
+    uint8_t line = interrupts.select(sr & SR_GIE);
+
+    if (line == InterruptController::NO_LINE)
+    {
+        return;
+    }
+    interrupts.acknowledge(line);
+
+    uint32_t pc = registers_[REG_IDX_PC];
+    uint32_t sp = registers_[REG_IDX_SP];
+
+    TRACE_DEBUG(TRACE_CPU, "interrupt %d from %X\n", line, pc);
+    devicesManager_.writeWord(sp - 2, pc & 0xFFFF);
+    devicesManager_.writeWord(sp - 4, ((pc >> 4) & 0xF000) | (sr & 0x0FFF));
+    setRegister(REG_IDX_SP, (sp - 4) & 0xFFFFF);
+    setRegister(REG_IDX_SR, sr & SR_SCG0);
+    setRegister(REG_IDX_PC, devicesManager_.readWord(
+                                InterruptController::vectorAddress(line)));
+
+    cycles_ += INTERRUPT_CYCLES;
+    devicesManager_.runEvents(cycles_);
+}
+
+/**
+ * Runs the block at PC, or lets time pass if the CPU is off. Returns the
+ * block to chain the next one to.
+ */
+Block *MSP430::runNextBlock(Block *previous)
+{
+    Block *block = nullptr;
+
+    if (isInterruptReady())
+    {
+        enterInterrupt();
+        return nullptr;
+    }
+
+    if (isCpuOff())
+    {
+        idle();
+        return nullptr;
+    }
+
+    block = nextBlock(previous, getRegister(REG_IDX_PC));
+    executeBlock(block);
+
+    // Blocks invalidated by the one just run can now be freed
+    if (!block->valid)
+    {
+        block = nullptr;
+    }
+    blockCache_.collectRetired();
+    return block;
+}
+
+void MSP430::run()
+{
+    Block *block = nullptr;
+    uint64_t nextPinFlush = cycles_ + PIN_FLUSH_CYCLES;
+
+    pacer_.start(cycles_);
+    while (!stopRequested_.load(std::memory_order_relaxed))
+    {
+        block = runNextBlock(block);
+        if (cycles_ >= nextPinFlush)
+        {
+            devicesManager_.flushPinChanges();
+            nextPinFlush = cycles_ + PIN_FLUSH_CYCLES;
+        }
+        pacer_.pace(cycles_);
+    }
+    devicesManager_.flushPinChanges();
+    stopRequested_ = false;
+}
+
+/**
+ * Runs until cycles more CPU cycles have been spent.
+ */
+MSP430::STOP_REASON MSP430::runFor(uint64_t cycles)
+{
+    return runBounded({cycles_ + cycles, NO_LIMIT, NO_TARGET_PC, true});
+}
+
+/**
+ * Runs until PC reaches pc, or at most maxCycles CPU cycles.
+ */
+MSP430::STOP_REASON MSP430::runUntil(uint32_t pc, uint64_t maxCycles)
+{
+    uint64_t cycles = (maxCycles == NO_LIMIT) ? NO_LIMIT : cycles_ + maxCycles;
+
+    return runBounded({cycles, NO_LIMIT, pc, true});
+}
+
+/**
+ * Runs count instructions. A repeated instruction counts once per
+ * repetition but is never split.
+ */
+MSP430::STOP_REASON MSP430::step(uint64_t count)
+{
+    return runBounded(
+        {NO_LIMIT, executedInstructions_ + count, NO_TARGET_PC, true});
+}
+
+/**
+ * Tells why a bounded run must stop before the instruction at PC, or
+ * STOP_NONE. Breakpoints and the target PC are ignored on the first
+ * instruction, so that a run can resume from them.
+ */
+MSP430::STOP_REASON MSP430::checkLimits(const RunLimits &limits, bool first)
+{
+    uint32_t pc = registers_[REG_IDX_PC];
+
+    if (stopRequested_.load(std::memory_order_relaxed) &&
+        stopRequested_.exchange(false))
+    {
+        return STOP_REQUESTED;
+    }
+    if (cycles_ >= limits.cycles)
+    {
+        return STOP_CYCLES;
+    }
+    if (executedInstructions_ >= limits.instructions)
+    {
+        return STOP_INSTRUCTIONS;
+    }
+    if (!first && (pc == limits.pc))
+    {
+        return STOP_TARGET_PC;
+    }
+    if (!first && limits.breakpoints && !breakpoints_.empty() &&
+        breakpoints_.count(pc))
+    {
+        return STOP_BREAKPOINT;
+    }
+    return STOP_NONE;
+}
+
+/**
+ * Tells if a whole block can run without reaching any limit but on its
+ * last instruction boundary.
+ */
+bool MSP430::blockFitsLimits(const Block *block,
+                             const RunLimits &limits) const
+{
+    if ((cycles_ + block->maxCycles > limits.cycles) ||
+        (executedInstructions_ + block->maxInstructions > limits.instructions))
+    {
+        return false;
+    }
+
+    // Writes are only checked for watchpoints between instructions
+    if (limits.breakpoints && devicesManager_.hasWriteWatches())
+    {
+        return false;
+    }
+
+    // The first instruction has already been checked
+    if ((limits.pc > block->startPc) && (limits.pc < block->endPc))
+    {
+        return false;
+    }
+    if (!limits.breakpoints)
+    {
+        return true;
+    }
+    auto breakpoint = breakpoints_.upper_bound(block->startPc);
+    return (breakpoint == breakpoints_.end()) || (*breakpoint >= block->endPc);
+}
+
+/**
+ * Runs until one of the limits is reached. The peripherals have been told
+ * about every output change of the run when it returns.
+ */
+MSP430::STOP_REASON MSP430::runBounded(const RunLimits &limits)
+{
+    STOP_REASON reason = runLimited(limits);
+
+    devicesManager_.flushPinChanges();
+    return reason;
+}
+
+/**
+ * Whole blocks are run while they cannot cross a limit; the block reaching
+ * one is run an instruction at a time, so that the run stops on the exact
+ * instruction. With watchpoints, every block is run an instruction at a
+ * time. The devices events keep firing in both cases.
+ */
+MSP430::STOP_REASON MSP430::runLimited(const RunLimits &limits)
+{
+    Block *block = nullptr;
+    bool first = true;
+
+    // Drop the watchpoint hits of earlier, unchecked, runs
+    devicesManager_.takeWatchHit();
+
+    while (true)
+    {
+        STOP_REASON reason = checkLimits(limits, first);
+
+        if (reason != STOP_NONE)
+        {
+            return reason;
+        }
+        first = false;
+
+        if (isInterruptReady())
+        {
+            enterInterrupt();
+            block = nullptr;
+            continue;
+        }
 
-            // Sleep for a short duration
-            usleep(SLEEP_DURATION);
+        if (isCpuOff())
+        {
+            if (devicesManager_.getNextEventTime() == EventScheduler::NO_EVENT)
+            {
+                return STOP_HALT;
+            }
+            idle(limits.cycles);
+            block = nullptr;
+            continue;
+        }
 
-            // Increment repetition counter
-            currentRepetition++;
+        block = nextBlock(block, registers_[REG_IDX_PC]);
+        if (blockFitsLimits(block, limits))
+        {
+            executeBlock(block);
+        }
+        else
+        {
+            for (size_t i = 0; i < block->ops.size(); i++)
+            {
+                if ((i > 0) &&
+                    ((reason = checkLimits(limits, false)) != STOP_NONE))
+                {
+                    return reason;
+                }
+                bool valid = executeBlockOp(block, block->ops[i]);
+
+                if (devicesManager_.takeWatchHit() && limits.breakpoints)
+                {
+                    return STOP_WATCHPOINT;
+                }
+                if (!valid)
+                {
+                    break;
+                }
+            }
+        }
 
-        } while (currentRepetition <= instr.repetition);
+        if (!block->valid)
+        {
+            block = nullptr;
+        }
+        blockCache_.collectRetired();
     }
 }
 
 /**
- * Displays debug information.
+ * Traces the registers and the top of the stack.
  */
 void MSP430::displayDebugInformation()
 {
-    std::cout << "----------- PC: " << std::hex << getRegister(REG_IDX_PC)
-              << " --------" << std::endl;
-    regDump();
-    devicesManager_.dump(getRegister(REG_IDX_SP) - 16, 32);
+    uint32_t sp = getRegister(REG_IDX_SP);
+
+    TRACE_DEBUG(TRACE_CPU, "----------- PC: %X --------\n",
+                getRegister(REG_IDX_PC));
+    for (int i = 0; i < NB_REGISTERS; i += 4)
+    {
+        TRACE_DEBUG(TRACE_CPU, "R%d: %05X R%d: %05X R%d: %05X R%d: %05X\n", i,
+                    getRegister(i), i + 1, getRegister(i + 1), i + 2,
+                    getRegister(i + 2), i + 3, getRegister(i + 3));
+    }
+    for (uint32_t address = sp - 16; address < sp + 16; address += 8)
+    {
+        TRACE_DEBUG(TRACE_BUS, "%X: %04X %04X %04X %04X\n", address,
+                    devicesManager_.readWord(address),
+                    devicesManager_.readWord(address + 2),
+                    devicesManager_.readWord(address + 4),
+                    devicesManager_.readWord(address + 6));
+    }
 }
@@ -1,12 +1,18 @@
 #pragma once
 
-#include <functional>
+#include <atomic>
+#include <set>
 #include <stdint.h>
 #include <string>
 #include <vector>
 
 #include "DevicesManager.h"
+#include "MSP430BlockCache.h"
+#include "MSP430DecodeCache.h"
+#include "MSP430DecodeTable.h"
 #include "MSP430InstructionHelper.h"
+#include "MSP430Jit.h"
+#include "MSP430Pacer.h"
 #include "Peripheral.h"
 
 // Forward declarations
@@ -15,8 +21,10 @@ class MSP430TestHelper;
 class Peripheral;
 class DevicesManager;
 
-class MSP430
+class MSP430 : private CodeWriteListener
 {
+    friend struct MSP430Handlers;
+
 public:
     // Status Register Structure
     union regStatus
@@ -38,14 +46,102 @@ public:
         uint32_t value;
     };
 
+    // Block execution backends
+    enum EXECUTION_BACKEND
+    {
+        BACKEND_INTERPRETER,
+        BACKEND_JIT, // hot blocks translated to host code
+    };
+
+    // Reasons for a bounded run to return
+    enum STOP_REASON
+    {
+        STOP_NONE,
+        STOP_CYCLES,       // cycle budget spent
+        STOP_INSTRUCTIONS, // instruction count reached
+        STOP_TARGET_PC,    // target address reached
+        STOP_BREAKPOINT,   // breakpoint reached
+        STOP_WATCHPOINT,   // watched address written by the last instruction
+        STOP_HALT,         // CPU off with no device event to wake it up
+        STOP_REQUESTED,    // requestStop() called
+    };
+
+    static constexpr uint64_t NO_LIMIT = UINT64_MAX;
+    static constexpr uint32_t NO_TARGET_PC = UINT32_MAX;
+
+    // Conditions ending a bounded run, as absolute counter values
+    struct RunLimits
+    {
+        uint64_t cycles;
+        uint64_t instructions;
+        uint32_t pc;
+        bool breakpoints; // stop on breakpoints and watchpoints
+    };
+
     MSP430();
     ~MSP430();
 
+    bool setExecutionBackend(EXECUTION_BACKEND backend);
+    EXECUTION_BACKEND getExecutionBackend() const { return backend_; }
+
+    // Pacing of run() against the host clock, real time by default
+    void setPacing(PACING_MODE mode, double speed = 1.0);
+    PACING_MODE getPacing() const { return pacer_.getMode(); }
+    void setCpuFrequency(uint64_t frequency);
+
     void run();
+    // Bounded runs, not paced against the host clock
+    STOP_REASON runFor(uint64_t cycles);
+    STOP_REASON runUntil(uint32_t pc, uint64_t maxCycles = NO_LIMIT);
+    STOP_REASON step(uint64_t count = 1);
+    STOP_REASON runBounded(const RunLimits &limits);
+    // Makes run() or the current bounded run return; thread safe
+    void requestStop() { stopRequested_ = true; }
+
+    void addBreakpoint(uint32_t pc) { breakpoints_.insert(pc); }
+    void removeBreakpoint(uint32_t pc) { breakpoints_.erase(pc); }
+    void clearBreakpoints() { breakpoints_.clear(); }
+    bool isBreakpoint(uint32_t pc) const { return breakpoints_.count(pc); }
+    // Stop bounded runs after an instruction writing to address
+    void addWatchpoint(uint32_t address)
+    {
+        devicesManager_.addWriteWatch(address);
+    }
+    void removeWatchpoint(uint32_t address)
+    {
+        devicesManager_.removeWriteWatch(address);
+    }
+
     void runOneInstruction(Instruction *instr);
     bool loadROM(std::string filename);
+    // Writes an image to the bus, from address. Returns false, writing
+    // nothing, if it does not fit in the bus.
+    bool loadImage(const uint8_t *data, size_t size, uint32_t address = 0);
+
+    // Machine snapshots: CPU, devices and pending device events. They can
+    // only be restored by the same build, and are taken between runs. A
+    // full snapshot is a memory checkpoint; incremental ones only hold the
+    // memory pages written since the last checkpoint.
+    static constexpr uint32_t SNAPSHOT_VERSION = 3;
+    bool saveSnapshot(std::vector<uint8_t> &buffer, bool incremental = false);
+    bool restoreSnapshot(const std::vector<uint8_t> &buffer);
+    bool restoreSnapshot(const uint8_t *data, size_t size);
+    bool saveSnapshotFile(const std::string &filename);
+    bool restoreSnapshotFile(const std::string &filename);
 
     DevicesManager &getDevicesManager() { return devicesManager_; }
+    // CPU cycles executed since power up
+    uint64_t getCycles() const { return cycles_; }
+    uint32_t getPc() const { return registers_[REG_IDX_PC]; }
+    void setPc(uint32_t pc) { setRegister(REG_IDX_PC, pc); }
+    // Register access between runs, the status register being up to date
+    uint32_t readRegister(uint8_t reg) { return getRegister(reg); }
+    void writeRegister(uint8_t reg, uint32_t value)
+    {
+        setRegister(reg, value);
+    }
+    // Instructions executed since power up, repetitions included
+    uint64_t getExecutedInstructions() const { return executedInstructions_; }
 
     static constexpr uint8_t NB_REGISTERS = 16;
     static constexpr uint8_t REG_IDX_PC = 0;
@@ -53,9 +149,46 @@ public:
     static constexpr uint8_t REG_IDX_SR = 2;
     static constexpr uint8_t REG_IDX_CG2 = 3;
 
+    // Status register bits not tracked by the lazy flags
+    static constexpr uint32_t SR_GIE = 0x08;
+    static constexpr uint32_t SR_CPUOFF = 0x10;
+    static constexpr uint32_t SR_SCG0 = 0x40;
+
+    // Longest delay of run() before delivering port output changes
+    static constexpr uint64_t PIN_FLUSH_CYCLES = 1000;
+
+    // Cycles taken to enter an interrupt handler
+    static constexpr uint32_t INTERRUPT_CYCLES = 6;
+
+    // Simulated time skipped at once when the CPU is off with no event
+    // pending
+    static constexpr uint64_t IDLE_CYCLES = 10000;
+
 private:
     uint32_t registers_[NB_REGISTERS];
     DevicesManager devicesManager_;
+    uint64_t executedInstructions_;
+    uint64_t cycles_; // time base of the devices
+    MSP430DecodeCache decodeCache_;
+    MSP430BlockCache blockCache_;
+    MSP430Jit jit_;
+    EXECUTION_BACKEND backend_;
+    MSP430Pacer pacer_;
+    std::set<uint32_t> breakpoints_;
+    std::atomic<bool> stopRequested_;
+
+    // Operands and result of the last ALU operation whose status flags have
+    // not been computed yet (op is its DECODE_HANDLER_* id)
+    struct LazyFlags
+    {
+        uint8_t op;
+        uint32_t result;
+        uint32_t src;
+        uint32_t dst;
+        uint32_t mask;
+    };
+    LazyFlags lazyFlags_;
+    bool flagsPending_;
 
     // Register-related Methods
     uint16_t fetch();
@@ -71,8 +204,13 @@ private:
     void regSetZero(regStatus &status, bool value);
     void regSetCarry(regStatus &status, bool value);
     void regDump();
+    void materializeFlags();
 
     // Instruction-related Methods
+    void fetchOperandExtension(InstructionOperand *operand, uint32_t pc);
+    void decodeInstructionSource(InstructionOperand *operand, uint32_t pc);
+    void decodeInstructionDestination(InstructionOperand *operand,
+                                      uint32_t pc);
     void updateInstructionSource(InstructionOperand *operand);
     void updateInstructionValue(InstructionOperand *operand);
     void updateInstructionDestination(InstructionOperand *operand);
@@ -80,10 +218,47 @@ private:
     void decodeInstructionMajorOpcode10(Instruction *instr);
     void decodeInstructionMajorOpcode14(Instruction *instr);
     void decodeCoreInstruction(Instruction *instr, bool extended);
+    void fetchTableOperandExtension(InstructionOperand *operand,
+                                    const DecodeOperand &entry, uint32_t pc);
+    void decodeStaticInstruction(Instruction *instr);
+    void decodeReferenceInstruction(Instruction *instr);
+    void resolveInstruction(Instruction *instr, uint32_t pc);
     Instruction decodeInstruction();
+    void onCodeWrite(uint32_t address, uint32_t nbBytes) override;
     uint32_t getInstructionMaskValue(InstructionOperand *operand);
     uint32_t getInstructionSignMask(InstructionOperand *operand);
 
+    // Basic block translation and threaded dispatch
+    OpHandler selectHandler(const Instruction &instr);
+    Block *buildBlock(uint32_t pc);
+    Block *nextBlock(Block *previous, uint32_t pc);
+    bool executeBlockOp(Block *block, BlockOp &op);
+    void applyZeroCarry(const Instruction *instr);
+    void runRepetitions(Instruction *instr, OpHandler handler, uint32_t pc);
+    void runBlock(Block *block);
+    void executeBlock(Block *block);
+    Block *runNextBlock(Block *previous);
+    bool isCpuOff() const
+    {
+        return (registers_[REG_IDX_SR] & SR_CPUOFF) != 0;
+    }
+    void idle(uint64_t limit = NO_LIMIT);
+    // One word test in the common case: no interrupt pending
+    bool isInterruptReady()
+    {
+        uint32_t pending = devicesManager_.getInterrupts().getPending();
+
+        return pending && ((registers_[REG_IDX_SR] & SR_GIE) ||
+                           (pending & InterruptController::NON_MASKABLE));
+    }
+    void enterInterrupt();
+    STOP_REASON runLimited(const RunLimits &limits);
+    STOP_REASON checkLimits(const RunLimits &limits, bool first);
+    bool blockFitsLimits(const Block *block, const RunLimits &limits) const;
+    JitLayout jitLayout();
+    static bool jitExecuteOp(MSP430 *cpu, Block *block, BlockOp *op);
+    static bool jitAccount(MSP430 *cpu, uint32_t count, uint32_t cycles);
+
     // Function related to instruction run
     bool checkCondition(uint8_t opcode);
     void instructionWrite(Instruction *instr, uint32_t value, std::string str,
@@ -102,10 +277,10 @@ private:
     void runRraInstruction(Instruction *instr);
     void runSwpbInstruction(Instruction *instr);
     void runSxtInstruction(Instruction *instr);
-    void executeLogicalOp(Instruction *instr,
-                          std::function<uint32_t(uint32_t, uint32_t)> op,
-                          bool updateStatus, uint32_t operand1 = 0,
-                          uint32_t operand2 = 0, bool isXor = false);
+    template <typename Op>
+    void executeLogicalOp(Instruction *instr, Op op, bool updateStatus,
+                          uint32_t operand1 = 0, uint32_t operand2 = 0,
+                          bool isXor = false);
     void runBitInstruction(Instruction *instr);
     void runBicInstruction(Instruction *instr);
     void runBisInstruction(Instruction *instr);
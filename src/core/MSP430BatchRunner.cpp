@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <string.h>
+#include <thread>
+
+#include "MSP430BatchRunner.h"
+
+MSP430BatchRunner::MSP430BatchRunner(unsigned nbWorkers) : nbSteals_(0)
+{
+    if (nbWorkers == 0)
+    {
+        nbWorkers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < nbWorkers; i++)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+}
+
+MSP430BatchRunner::~MSP430BatchRunner() {}
+
+void MSP430BatchRunner::run(size_t nbJobs, const Job &job)
+{
+    size_t nbWorkers = workers_.size();
+    std::vector<std::thread> threads;
+
+    nbSteals_ = 0;
+    error_ = nullptr;
+    for (size_t i = 0; i < nbWorkers; i++)
+    {
+        workers_[i]->next = nbJobs * i / nbWorkers;
+        workers_[i]->end = nbJobs * (i + 1) / nbWorkers;
+    }
+
+    // The calling thread is the first worker
+    for (unsigned i = 1; i < nbWorkers; i++)
+    {
+        threads.emplace_back([this, i, &job] { work(i, job); });
+    }
+    work(0, job);
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    if (error_)
+    {
+        std::rethrow_exception(error_);
+    }
+}
+
+void MSP430BatchRunner::work(unsigned id, const Job &job)
+{
+    Worker &worker = *workers_[id];
+    size_t index;
+
+    // Machines are built by the thread using them, so that their memory is
+    // local to it
+    if (!worker.cpu)
+    {
+        worker.cpu = std::make_unique<MSP430>();
+
+        // Memory content is undefined at power up: clear it so that jobs
+        // give the same results whatever the worker
+        auto memory = worker.cpu->getDevicesManager().getMemoryDevice();
+        memset(memory->data(), 0, memory->size());
+        worker.cpu->saveSnapshot(worker.powerUpState);
+    }
+
+    while (takeJob(worker, index) || (steal(id) && takeJob(worker, index)))
+    {
+        try
+        {
+            job(*worker.cpu, index);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard(statsLock_);
+            if (!error_)
+            {
+                error_ = std::current_exception();
+            }
+        }
+        recycle(worker);
+    }
+}
+
+bool MSP430BatchRunner::takeJob(Worker &worker, size_t &index)
+{
+    std::lock_guard<std::mutex> guard(worker.lock);
+
+    if (worker.next == worker.end)
+    {
+        return false;
+    }
+    index = worker.next++;
+    return true;
+}
+
+/**
+ * Moves the second half of the largest range left to the thief. Returns
+ * false once no worker has jobs left to give.
+ */
+bool MSP430BatchRunner::steal(unsigned thief)
+{
+    while (true)
+    {
+        Worker *victim = nullptr;
+        size_t largest = 0;
+
+        // Only a hint: the victim may run jobs before it is locked again
+        for (unsigned i = 0; i < workers_.size(); i++)
+        {
+            Worker &worker = *workers_[i];
+            size_t left;
+            {
+                std::lock_guard<std::mutex> guard(worker.lock);
+                left = worker.end - worker.next;
+            }
+            if ((i != thief) && (left > largest))
+            {
+                victim = &worker;
+                largest = left;
+            }
+        }
+
+        if (victim == nullptr)
+        {
+            return false;
+        }
+
+        size_t begin;
+        size_t end;
+        {
+            std::lock_guard<std::mutex> guard(victim->lock);
+            size_t left = victim->end - victim->next;
+            if (left == 0)
+            {
+                // Emptied meanwhile, look again
+                continue;
+            }
+            end = victim->end;
+            begin = end - (left + 1) / 2;
+            victim->end = begin;
+        }
+
+        Worker &worker = *workers_[thief];
+        {
+            std::lock_guard<std::mutex> guard(worker.lock);
+            worker.next = begin;
+            worker.end = end;
+        }
+        std::lock_guard<std::mutex> guard(statsLock_);
+        nbSteals_++;
+        return true;
+    }
+}
+
+// Brings a machine back to its power up state
+void MSP430BatchRunner::recycle(Worker &worker)
+{
+    MSP430 &cpu = *worker.cpu;
+    DevicesManager &bus = cpu.getDevicesManager();
+
+    cpu.clearBreakpoints();
+    bus.clearWriteWatches();
+    bus.unregisterPeripherals();
+    bus.getInputLog().stop();
+    cpu.restoreSnapshot(worker.powerUpState);
+}
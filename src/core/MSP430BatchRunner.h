@@ -0,0 +1,67 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "MSP430.h"
+
+/**
+ * Runs many independent jobs, each on its own MSP430, on all host cores.
+ *
+ * Each worker thread owns one machine, built once and recycled between
+ * jobs by restoring the snapshot taken right after its construction: only
+ * the memory pages dirtied by the previous job are rewritten. Peripherals,
+ * breakpoints and watchpoints are dropped too; the execution backend and
+ * pacing are kept.
+ *
+ * Jobs are dealt to the workers as contiguous index ranges. A worker whose
+ * range is exhausted steals half of the largest remaining one, so that
+ * long jobs do not leave cores idle.
+ */
+class MSP430BatchRunner
+{
+public:
+    // Runs the job of the given index on a machine in its power up state.
+    // Jobs are called concurrently and must only share read-only data.
+    typedef std::function<void(MSP430 &cpu, size_t index)> Job;
+
+    // nbWorkers 0 uses one worker per host core
+    explicit MSP430BatchRunner(unsigned nbWorkers = 0);
+    ~MSP430BatchRunner();
+
+    unsigned getNbWorkers() const { return workers_.size(); }
+
+    // Runs job for indices 0 to nbJobs - 1 and returns once all are done.
+    // The first exception thrown by a job is rethrown.
+    void run(size_t nbJobs, const Job &job);
+
+    // Statistics of the last run
+    uint64_t getNbSteals() const { return nbSteals_; }
+
+private:
+    struct Worker
+    {
+        std::unique_ptr<MSP430> cpu;
+        std::vector<uint8_t> powerUpState;
+
+        // Indices left to run, taken from the front by the worker and
+        // from the back by thieves
+        std::mutex lock;
+        size_t next;
+        size_t end;
+    };
+
+    void work(unsigned id, const Job &job);
+    bool takeJob(Worker &worker, size_t &index);
+    bool steal(unsigned thief);
+    void recycle(Worker &worker);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex statsLock_;
+    uint64_t nbSteals_;
+    std::exception_ptr error_;
+};
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <assert.h>
+
+#include "MSP430.h"
+#include "MSP430BlockCache.h"
+
+/**
+ * Tells if an instruction terminates a basic block.
+ *
+ * Blocks end on any instruction that may change the control flow (jumps,
+ * CALLA, RETI, writes to PC) or the CPU state checked between blocks (writes
+ * to SR). POPM may restore either of them and always ends a block.
+ */
+bool instructionEndsBlock(const Instruction &instr)
+{
+    const InstructionOperand &dst = instr.destination;
+
+    if ((instr.format == 3) || (instr.majorOpcode == MAJOR_OPCODE_10))
+    {
+        return true;
+    }
+
+    if ((instr.majorOpcode == MAJOR_OPCODE_14) &&
+        ((instr.minorOpcode == 0x16) || (instr.minorOpcode == 0x17)))
+    {
+        return true;
+    }
+
+    return (dst.addrMode == ADDR_MODE_REGISTER) &&
+           ((dst.reg == MSP430::REG_IDX_PC) || (dst.reg == MSP430::REG_IDX_SR));
+}
+
+Block *MSP430BlockCache::lookup(uint32_t pc) const
+{
+    auto it = blocks_.find(pc);
+    return (it != blocks_.end()) ? it->second.get() : nullptr;
+}
+
+Block *MSP430BlockCache::insert(std::unique_ptr<Block> block)
+{
+    Block *raw = block.get();
+
+    assert(raw->endPc - raw->startPc <= MAX_BLOCK_SIZE);
+    assert(lookup(raw->startPc) == nullptr);
+
+    raw->valid = true;
+    raw->next[Block::EDGE_TAKEN] = nullptr;
+    raw->next[Block::EDGE_NOT_TAKEN] = nullptr;
+    raw->linkGeneration = generation_;
+    raw->execCount = 0;
+    raw->native = nullptr;
+
+    pageBlocks_[raw->startPc >> PAGE_SHIFT].push_back(raw->startPc);
+    blocks_[raw->startPc] = std::move(block);
+    return raw;
+}
+
+Block *MSP430BlockCache::getLink(Block *block, uint8_t edge) const
+{
+    if (block->linkGeneration != generation_)
+    {
+        return nullptr;
+    }
+    return block->next[edge];
+}
+
+void MSP430BlockCache::setLink(Block *block, uint8_t edge, Block *next)
+{
+    // Links made before an invalidation may point to retired blocks
+    if (block->linkGeneration != generation_)
+    {
+        block->next[Block::EDGE_TAKEN] = nullptr;
+        block->next[Block::EDGE_NOT_TAKEN] = nullptr;
+        block->linkGeneration = generation_;
+    }
+    block->next[edge] = next;
+}
+
+void MSP430BlockCache::retire(Block *block)
+{
+    auto it = blocks_.find(block->startPc);
+    assert(it != blocks_.end());
+
+    block->valid = false;
+    retired_.push_back(std::move(it->second));
+    blocks_.erase(it);
+}
+
+/**
+ * Invalidates the blocks overlapping a written address range.
+ */
+void MSP430BlockCache::invalidate(uint32_t address, uint32_t nbBytes)
+{
+    uint32_t lastPage = (address + nbBytes - 1) >> PAGE_SHIFT;
+    uint32_t firstPage = address >> PAGE_SHIFT;
+    bool invalidated = false;
+
+    if (firstPage > 0)
+    {
+        firstPage--;
+    }
+
+    for (uint32_t page = firstPage; page <= lastPage; page++)
+    {
+        auto pageIt = pageBlocks_.find(page);
+        if (pageIt == pageBlocks_.end())
+        {
+            continue;
+        }
+
+        std::vector<uint32_t> &starts = pageIt->second;
+        for (auto it = starts.begin(); it != starts.end();)
+        {
+            Block *block = lookup(*it);
+            if ((block->startPc < address + nbBytes) &&
+                (block->endPc > address))
+            {
+                retire(block);
+                it = starts.erase(it);
+                invalidated = true;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    if (invalidated)
+    {
+        generation_++;
+    }
+}
+
+void MSP430BlockCache::flush()
+{
+    for (auto &entry : blocks_)
+    {
+        entry.second->valid = false;
+        retired_.push_back(std::move(entry.second));
+    }
+    blocks_.clear();
+    pageBlocks_.clear();
+    generation_++;
+}
+
+void MSP430BlockCache::collectRetired() { retired_.clear(); }
+
+/**
+ * Drops all translated code, e.g. once the JIT code buffer has been reset.
+ */
+void MSP430BlockCache::clearNativeCode()
+{
+    for (auto &entry : blocks_)
+    {
+        entry.second->execCount = 0;
+        entry.second->native = nullptr;
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "MSP430InstructionHelper.h"
+
+class MSP430;
+
+// Executes an instruction whose operands have been resolved
+typedef void (*OpHandler)(MSP430 *cpu, Instruction *instr);
+
+// Entry point of a block translated to host code
+typedef void (*JitBlockFn)(uint32_t *registers, MSP430 *cpu);
+
+// Pre-decoded instruction of a block, bound to its execute handler
+struct BlockOp
+{
+    Instruction instr; // static part, resolved before each execution
+    OpHandler handler;
+};
+
+/**
+ * Basic block: straight-line run of instructions ending at a jump, CALLA,
+ * RETI or a write to PC/SR.
+ *
+ * Blocks are chained to their successors on the taken (conditional or
+ * unconditional jump target) and not-taken (fall through) edges. Links are
+ * only valid while linkGeneration matches the cache generation, which
+ * changes whenever a block is invalidated.
+ */
+struct Block
+{
+    static constexpr uint8_t EDGE_TAKEN = 0;
+    static constexpr uint8_t EDGE_NOT_TAKEN = 1;
+    static constexpr uint32_t NO_TARGET = UINT32_MAX;
+
+    uint32_t startPc;
+    uint32_t endPc; // address following the last instruction
+    uint32_t takenPc;
+    // Upper bounds of a block run, repeated instructions at their maximum
+    uint32_t maxCycles;
+    uint32_t maxInstructions;
+    bool valid;
+    std::vector<BlockOp> ops;
+
+    Block *next[2];
+    uint64_t linkGeneration;
+
+    uint32_t execCount; // executions before translation
+    JitBlockFn native;  // translated code, nullptr if not translated
+};
+
+bool instructionEndsBlock(const Instruction &instr);
+
+class MSP430BlockCache
+{
+public:
+    // Blocks never span more than MAX_BLOCK_SIZE bytes, so only blocks
+    // starting in the same or previous page can cover a written address.
+    static constexpr uint32_t MAX_BLOCK_OPS = 64;
+    static constexpr uint32_t PAGE_SHIFT = 9;
+    static constexpr uint32_t MAX_BLOCK_SIZE = 1 << PAGE_SHIFT;
+
+    Block *lookup(uint32_t pc) const;
+    Block *insert(std::unique_ptr<Block> block);
+    Block *getLink(Block *block, uint8_t edge) const;
+    void setLink(Block *block, uint8_t edge, Block *next);
+    void invalidate(uint32_t address, uint32_t nbBytes);
+    void flush();
+    void collectRetired();
+    void clearNativeCode();
+
+private:
+    void retire(Block *block);
+
+    std::unordered_map<uint32_t, std::unique_ptr<Block>> blocks_;
+    // Block start addresses, by page of the start address
+    std::unordered_map<uint32_t, std::vector<uint32_t>> pageBlocks_;
+    // Invalidated blocks, kept alive until the CPU leaves them
+    std::vector<std::unique_ptr<Block>> retired_;
+    uint64_t generation_ = 0;
+};
@@ -0,0 +1,58 @@
+#include <assert.h>
+
+#include "MSP430DecodeCache.h"
+
+MSP430DecodeCache::MSP430DecodeCache() : entries_(NB_ENTRIES) { flush(); }
+
+const Instruction *MSP430DecodeCache::lookup(uint32_t pc) const
+{
+    const Entry &entry = entries_[indexOf(pc)];
+
+    if (entry.valid && (entry.pc == pc))
+    {
+        return &entry.instr;
+    }
+    return nullptr;
+}
+
+void MSP430DecodeCache::insert(uint32_t pc, const Instruction &instr)
+{
+    assert(instr.size <= MAX_INSTRUCTION_SIZE);
+
+    Entry &entry = entries_[indexOf(pc)];
+    entry.pc = pc;
+    entry.valid = true;
+    entry.instr = instr;
+}
+
+/**
+ * Drops the cached instructions overlapping a written address range.
+ *
+ * An instruction is at most MAX_INSTRUCTION_SIZE bytes long, so only the
+ * entries starting in the preceding bytes can cover the written range.
+ */
+void MSP430DecodeCache::invalidate(uint32_t address, uint32_t nbBytes)
+{
+    uint32_t first = (address >= MAX_INSTRUCTION_SIZE)
+                         ? address - MAX_INSTRUCTION_SIZE + 1
+                         : 0;
+
+    for (uint32_t pc = first & ~1u; pc < address + nbBytes; pc += 2)
+    {
+        Entry &entry = entries_[indexOf(pc)];
+
+        if (entry.valid && (entry.pc == pc) &&
+            (entry.pc + entry.instr.size > address))
+        {
+            entry.valid = false;
+        }
+    }
+}
+
+void MSP430DecodeCache::flush()
+{
+    for (auto &entry : entries_)
+    {
+        entry.valid = false;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "MSP430InstructionHelper.h"
+
+/**
+ * Cache of statically decoded instructions, indexed by PC.
+ *
+ * Entries hold the part of an Instruction that only depends on the
+ * instruction words (opcode, format, addressing modes, registers and
+ * extension words). Operand values are still resolved at execution time.
+ * The cache is direct mapped, and entries covering a written address are
+ * dropped through invalidate().
+ */
+class MSP430DecodeCache
+{
+public:
+    static constexpr uint32_t NB_ENTRIES = 4096;
+    static constexpr uint32_t MAX_INSTRUCTION_SIZE = 8;
+
+    MSP430DecodeCache();
+
+    const Instruction *lookup(uint32_t pc) const;
+    void insert(uint32_t pc, const Instruction &instr);
+    void invalidate(uint32_t address, uint32_t nbBytes);
+    void flush();
+
+private:
+    struct Entry
+    {
+        uint32_t pc;
+        bool valid;
+        Instruction instr;
+    };
+
+    static uint32_t indexOf(uint32_t pc)
+    {
+        return (pc >> 1) & (NB_ENTRIES - 1);
+    }
+
+    std::vector<Entry> entries_;
+};
@@ -0,0 +1,367 @@
+#include <utility>
+
+#include "MSP430DecodeTable.h"
+
+/*
+ * The table is generated at compile time from the same rules as the
+ * reference decoder (decodeMajorOpcode(), opcodeToFormat(),
+ * bwAlFlagToWordSize(), axFlagToAddrMode() and the decodeInstruction*
+ * methods of MSP430). TestDecodeTable checks both agree on every word.
+ */
+
+static constexpr uint8_t tableMajorOpcode(uint16_t raw)
+{
+    uint8_t majorOpcode = (raw >> 8) & 0xFC;
+
+    if (((majorOpcode & 0xF0) >= 0x40) || ((majorOpcode & 0xF0) == 0x00))
+    {
+        majorOpcode &= 0xF0;
+    }
+    return majorOpcode;
+}
+
+static constexpr uint8_t tableAxFlagToAddrMode(uint8_t axFlag, uint8_t reg)
+{
+    switch (axFlag)
+    {
+    case 0:
+        return ADDR_MODE_REGISTER;
+    case 1:
+        if (reg == 0)
+        {
+            return ADDR_MODE_SYMBOLIC;
+        }
+        return (reg == 2) ? ADDR_MODE_ABSOLUTE : ADDR_MODE_INDEXED;
+    case 2:
+        return ADDR_MODE_INDIRECT_REGISTER;
+    default:
+        return (reg == 0) ? ADDR_MODE_IMMEDIATE : ADDR_MODE_INDIRECT_REGISTER;
+    }
+}
+
+static constexpr uint8_t tableAddrModeToWordSize(uint8_t addrMode,
+                                                 uint8_t wordSize)
+{
+    if ((addrMode == ADDR_MODE_ABSOLUTE) || (addrMode == ADDR_MODE_INDEXED) ||
+        (addrMode == ADDR_MODE_IMMEDIATE) ||
+        (addrMode == ADDR_MODE_INDIRECT_AUTOINCREMENT))
+    {
+        return wordSize;
+    }
+    return WORD;
+}
+
+// Extension word rules of MSP430::fetchOperandExtension()
+static constexpr uint8_t tableExtWordFlags(uint8_t addrMode)
+{
+    switch (addrMode)
+    {
+    case ADDR_MODE_INVALID:
+    case ADDR_MODE_REGISTER:
+    case ADDR_MODE_INDIRECT_AUTOINCREMENT:
+        return 0;
+    case ADDR_MODE_IMMEDIATE:
+    case ADDR_MODE_INDEXED:
+    case ADDR_MODE_ABSOLUTE:
+        return DECODE_OPD_EXT_BYTE | DECODE_OPD_EXT_WIDE;
+    default:
+        return DECODE_OPD_EXT_WIDE;
+    }
+}
+
+static constexpr bool tableUsesConstantGenerator(const DecodeOperand &src)
+{
+    return ((src.reg == 2) && (src.axFlag > 1) && (src.axFlag <= 3)) ||
+           ((src.reg == 3) && (src.axFlag <= 3));
+}
+
+static constexpr uint16_t tableConstantGeneratorValue(uint8_t reg,
+                                                      uint8_t axFlag)
+{
+    if (reg == 3)
+    {
+        constexpr uint16_t values[] = {0, 1, 2, 0xFFFF};
+        return values[axFlag];
+    }
+    return (axFlag == 2) ? 4 : 8;
+}
+
+static constexpr void tableDecodeCore(DecodeEntry &e, uint16_t raw)
+{
+    DecodeOperand &src = e.source;
+    DecodeOperand &dst = e.destination;
+    uint8_t opcode = tableMajorOpcode(raw);
+
+    e.kind = DECODE_KIND_CORE;
+    e.handler = opcodeToHandler(opcode);
+    e.minorOpcode = opcode;
+    e.format = (opcode >= 0x40) ? 1 : 3;
+
+    src.axFlag = (raw >> 4) & 0x3;
+    dst.axFlag = (raw >> 7) & 0x1;
+    dst.reg = raw & 0xF;
+    src.reg = (raw >> 8) & 0xF;
+    src.wordSize = dst.wordSize = (raw & 0x0040) ? BYTE : WORD;
+
+    if (e.format == 3)
+    {
+        src.addrMode = ADDR_MODE_INDEXED;
+        dst.addrMode = ADDR_MODE_INVALID;
+        dst.value = raw & 0x1FF;
+        src.value = 0;
+        return;
+    }
+
+    src.flags = dst.flags = DECODE_OPD_UPDATE_VALUE;
+    src.addrMode = tableAxFlagToAddrMode(src.axFlag, src.reg);
+    dst.addrMode = tableAxFlagToAddrMode(dst.axFlag, dst.reg);
+    src.value = ((src.addrMode == ADDR_MODE_INDEXED) ||
+                 (src.addrMode == ADDR_MODE_ABSOLUTE))
+                    ? 0
+                    : src.reg;
+    dst.value = ((dst.addrMode == ADDR_MODE_INDEXED) ||
+                 (dst.addrMode == ADDR_MODE_ABSOLUTE))
+                    ? 0
+                    : dst.reg;
+}
+
+static constexpr void tableDecodeExt00(DecodeEntry &e, uint16_t raw)
+{
+    DecodeOperand &src = e.source;
+    DecodeOperand &dst = e.destination;
+
+    e.kind = DECODE_KIND_EXT00;
+    e.format = 1;
+    e.extended = 1;
+    e.minorOpcode = (raw >> 4) & 0xF;
+    src.addrMode = dst.addrMode = ADDR_MODE_REGISTER;
+    src.reg = (raw >> 8) & 0xF;
+    dst.reg = raw & 0xF;
+    src.value = src.reg;
+    dst.value = dst.reg;
+    src.flags = dst.flags = DECODE_OPD_UPDATE_VALUE;
+
+    switch (e.minorOpcode)
+    {
+    case MINOR_EXT00_MOVA_INDIRECT_REGISTER:
+        src.addrMode = ADDR_MODE_INDIRECT_REGISTER;
+        break;
+    case MINOR_EXT00_MOVA_INDIRECT_AUTOINCREMENT:
+        src.addrMode = ADDR_MODE_INDIRECT_AUTOINCREMENT;
+        break;
+    case MINOR_EXT00_MOVA_ABSOLUTE_SOURCE:
+        src.addrMode = ADDR_MODE_ABSOLUTE;
+        break;
+    case MINOR_EXT00_MOVA_INDEXED_SOURCE:
+        src.addrMode = ADDR_MODE_INDEXED;
+        break;
+    case MINOR_EXT00_RR_RL_A_OPCODE:
+    case MINOR_EXT00_RR_RL_W_OPCODE:
+        // Rotation count fits in bits 10 and 11 of the instruction word
+        src.addrMode = ADDR_MODE_IMMEDIATE;
+        src.flags = 0;
+        src.value >>= 2;
+        break;
+    case MINOR_EXT00_MOVA_ABSOLUTE_DESINTATION:
+        dst.addrMode = ADDR_MODE_ABSOLUTE;
+        break;
+    case MINOR_EXT00_MOVA_INDEXED_DESTINATION:
+        dst.addrMode = ADDR_MODE_INDEXED;
+        break;
+    case MINOR_EXT00_MOVA_IMMEDIATE:
+    case MINOR_EXT00_CMPA_IMMEDIATE:
+    case MINOR_EXT00_ADDA_IMMEDIATE:
+    case MINOR_EXT00_SUBA_IMMEDIATE:
+        src.addrMode = ADDR_MODE_IMMEDIATE;
+        break;
+    case MINOR_EXT00_ADDA_REGISTER:
+    case MINOR_EXT00_SUBA_REGISTER:
+        src.axFlag = 2;
+        break;
+    default:
+        break;
+    }
+
+    src.wordSize = (e.minorOpcode == MINOR_EXT00_RR_RL_W_OPCODE)
+                       ? WORD
+                       : tableAddrModeToWordSize(src.addrMode, _20B_WORD);
+    dst.wordSize = tableAddrModeToWordSize(dst.addrMode, _20B_WORD);
+}
+
+static constexpr void tableDecodeExt10(DecodeEntry &e, uint16_t raw)
+{
+    DecodeOperand &src = e.source;
+    DecodeOperand &dst = e.destination;
+
+    e.kind = DECODE_KIND_EXT10;
+    e.format = 2;
+    e.extended = 1;
+    e.minorOpcode = (raw >> 4) & 0xFFF;
+    dst.addrMode = ADDR_MODE_INVALID;
+    dst.wordSize = WORD;
+    src.wordSize = _20B_WORD;
+    src.reg = raw & 0xF;
+    src.value = src.reg;
+    src.flags = dst.flags = DECODE_OPD_UPDATE_VALUE;
+    src.axFlag = dst.axFlag = 0xFF;
+
+    switch (e.minorOpcode)
+    {
+    case MINOR_EXT10_RETI:
+        src.addrMode = ADDR_MODE_INVALID;
+        break;
+    case MINOR_EXT10_CALLA_REGISTER:
+        src.addrMode = ADDR_MODE_REGISTER;
+        break;
+    case MINOR_EXT10_CALLA_INDEXED:
+        src.addrMode = ADDR_MODE_INDEXED;
+        break;
+    case MINOR_EXT10_CALLA_INDIRECT_REGISTER:
+        src.addrMode = ADDR_MODE_INDIRECT_REGISTER;
+        break;
+    case MINOR_EXT10_CALLA_INDIRECT_AUTOINCREMENT:
+        src.addrMode = ADDR_MODE_INDIRECT_AUTOINCREMENT;
+        break;
+    case MINOR_EXT10_CALLA_ABSOLUTE:
+        src.addrMode = ADDR_MODE_ABSOLUTE;
+        break;
+    case MINOR_EXT10_CALLA_SYMBOLIC:
+        src.addrMode = ADDR_MODE_SYMBOLIC;
+        break;
+    case MINOR_EXT10_CALLA_IMMEDIATE:
+        src.addrMode = ADDR_MODE_IMMEDIATE;
+        break;
+    default:
+        // RRC, SWPB, RRA, SXT, PUSH, CALL: not yet implemented
+        e.kind = DECODE_KIND_INVALID;
+        break;
+    }
+}
+
+static constexpr void tableDecodeExt14(DecodeEntry &e, uint16_t raw)
+{
+    DecodeOperand &src = e.source;
+    DecodeOperand &dst = e.destination;
+
+    e.kind = DECODE_KIND_EXT14;
+    e.format = 2;
+    e.extended = 1;
+    e.minorOpcode = (raw >> 8) & 0xFF;
+    src.wordSize = dst.wordSize = WORD;
+    src.addrMode = ADDR_MODE_IMMEDIATE;
+    dst.addrMode = ADDR_MODE_REGISTER;
+    src.reg = (raw >> 4) & 0xF;
+    dst.reg = raw & 0xF;
+    src.value = src.reg;
+    dst.value = dst.reg;
+    src.axFlag = dst.axFlag = 0xFF;
+}
+
+static constexpr DecodeEntry tableDecodeWord(uint16_t raw)
+{
+    DecodeEntry e = {};
+    DecodeOperand &src = e.source;
+    DecodeOperand &dst = e.destination;
+
+    e.majorOpcode = tableMajorOpcode(raw);
+
+    switch (e.majorOpcode)
+    {
+    case MAJOR_OPCODE_00:
+        tableDecodeExt00(e, raw);
+        break;
+    case MAJOR_OPCODE_10:
+        tableDecodeExt10(e, raw);
+        break;
+    case MAJOR_OPCODE_14:
+        tableDecodeExt14(e, raw);
+        break;
+    case MAJOR_OPCODE_18:
+    case MAJOR_OPCODE_1C:
+        e.kind = DECODE_KIND_PREFIX;
+        return e;
+    default:
+        tableDecodeCore(e, raw);
+        break;
+    }
+
+    if ((raw == 0) || (e.kind == DECODE_KIND_INVALID))
+    {
+        return DecodeEntry{};
+    }
+
+    if (src.flags & DECODE_OPD_UPDATE_VALUE)
+    {
+        src.flags |= tableExtWordFlags(src.addrMode);
+    }
+    if (dst.flags & DECODE_OPD_UPDATE_VALUE)
+    {
+        dst.flags |= tableExtWordFlags(dst.addrMode);
+    }
+
+    // The constant generator replaces the source, without extension word
+    if (tableUsesConstantGenerator(src))
+    {
+        src.value = tableConstantGeneratorValue(src.reg, src.axFlag);
+        src.addrMode = ADDR_MODE_IMMEDIATE;
+        src.flags = (src.flags | DECODE_OPD_CONSTANT_GENERATOR) &
+                    ~(DECODE_OPD_EXT_BYTE | DECODE_OPD_EXT_WIDE);
+    }
+
+    uint8_t sizeFlag =
+        (src.wordSize == BYTE) ? DECODE_OPD_EXT_BYTE : DECODE_OPD_EXT_WIDE;
+    e.nbExtWords = ((src.flags & sizeFlag) ? 1 : 0);
+    sizeFlag =
+        (dst.wordSize == BYTE) ? DECODE_OPD_EXT_BYTE : DECODE_OPD_EXT_WIDE;
+    e.nbExtWords += ((dst.flags & sizeFlag) ? 1 : 0);
+
+    e.cycles = instructionCycles(
+        e.majorOpcode, e.format, e.minorOpcode, e.handler, src.addrMode,
+        (src.flags & DECODE_OPD_CONSTANT_GENERATOR) != 0, src.value,
+        dst.addrMode, dst.reg);
+    return e;
+}
+
+/*
+ * Entries are generated by chunks: each chunk is a separate constant
+ * evaluation, which keeps every evaluation within the compiler's default
+ * constexpr operation limits.
+ */
+static constexpr uint32_t DECODE_CHUNK_SIZE = 0x1000;
+static constexpr uint32_t NB_DECODE_CHUNKS =
+    NB_DECODE_ENTRIES / DECODE_CHUNK_SIZE;
+
+typedef std::array<DecodeEntry, DECODE_CHUNK_SIZE> DecodeChunk;
+
+static constexpr DecodeChunk buildDecodeChunk(uint32_t chunk)
+{
+    DecodeChunk entries = {};
+
+    for (uint32_t i = 0; i < DECODE_CHUNK_SIZE; i++)
+    {
+        entries[i] = tableDecodeWord(chunk * DECODE_CHUNK_SIZE + i);
+    }
+    return entries;
+}
+
+template <uint32_t CHUNK>
+static constexpr DecodeChunk decodeChunk = buildDecodeChunk(CHUNK);
+
+template <uint32_t... CHUNKS>
+static constexpr std::array<DecodeEntry, NB_DECODE_ENTRIES>
+joinDecodeChunks(std::integer_sequence<uint32_t, CHUNKS...>)
+{
+    const DecodeChunk *chunks[] = {&decodeChunk<CHUNKS>...};
+    std::array<DecodeEntry, NB_DECODE_ENTRIES> table = {};
+
+    for (uint32_t raw = 0; raw < NB_DECODE_ENTRIES; raw++)
+    {
+        const DecodeChunk &chunk = *chunks[raw / DECODE_CHUNK_SIZE];
+        table[raw] = chunk[raw % DECODE_CHUNK_SIZE];
+    }
+    return table;
+}
+
+constexpr std::array<DecodeEntry, NB_DECODE_ENTRIES> decodeTable =
+    joinDecodeChunks(
+        std::make_integer_sequence<uint32_t, NB_DECODE_CHUNKS>());
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <array>
+#include <stdint.h>
+
+#include "MSP430InstructionHelper.h"
+
+// How the first instruction word is decoded
+enum DECODE_KIND
+{
+    DECODE_KIND_INVALID, // not decodable, handled by the reference decoder
+    DECODE_KIND_CORE,    // format I or jump (format III) instruction
+    DECODE_KIND_EXT00,   // MOVA, CMPA, ADDA, SUBA, RRxA/RRxX
+    DECODE_KIND_EXT10,   // RETI, CALLA
+    DECODE_KIND_EXT14,   // PUSHM, POPM
+    DECODE_KIND_PREFIX,  // 0x18/0x1C extension word, followed by a core word
+};
+
+// Execute handler of an instruction, DECODE_HANDLER_GENERIC when it goes
+// through the generic runOneInstruction() dispatch
+enum DECODE_HANDLER
+{
+    DECODE_HANDLER_GENERIC,
+    DECODE_HANDLER_JUMP,
+    DECODE_HANDLER_MOV,
+    DECODE_HANDLER_ADD,
+    DECODE_HANDLER_ADDC,
+    DECODE_HANDLER_SUBC,
+    DECODE_HANDLER_SUB,
+    DECODE_HANDLER_CMP,
+    DECODE_HANDLER_DADD,
+    DECODE_HANDLER_BIT,
+    DECODE_HANDLER_BIC,
+    DECODE_HANDLER_BIS,
+    DECODE_HANDLER_XOR,
+    DECODE_HANDLER_AND,
+    NB_DECODE_HANDLERS
+};
+
+// DecodeOperand flags
+static constexpr uint8_t DECODE_OPD_CONSTANT_GENERATOR = 0x01;
+static constexpr uint8_t DECODE_OPD_UPDATE_VALUE = 0x02;
+// An extension word follows when the operand is a byte / is wider
+static constexpr uint8_t DECODE_OPD_EXT_BYTE = 0x04;
+static constexpr uint8_t DECODE_OPD_EXT_WIDE = 0x08;
+
+struct DecodeOperand
+{
+    uint16_t value; // register, constant or jump offset before resolution
+    uint8_t reg;
+    uint8_t axFlag;
+    uint8_t addrMode; // enum ADDRESSING_MODE
+    uint8_t wordSize; // enum WORD_SIZE
+    uint8_t flags;    // DECODE_OPD_*
+};
+
+/**
+ * Static decoding of a first instruction word.
+ *
+ * Entries hold the same fields the reference decoder computes, constant
+ * generator included. For DECODE_KIND_PREFIX entries only kind and
+ * majorOpcode are set: the instruction is described by the entry of the
+ * following core word, with the word size and values of extended
+ * instructions applied on top of it.
+ */
+struct DecodeEntry
+{
+    uint8_t kind;    // enum DECODE_KIND
+    uint8_t handler; // enum DECODE_HANDLER
+    uint8_t majorOpcode;
+    uint8_t format;
+    uint16_t minorOpcode;
+    uint8_t extended;
+    uint8_t nbExtWords; // extension words following a non prefixed word
+    uint8_t cycles;     // CPU cycles, without the extension word
+    DecodeOperand source;
+    DecodeOperand destination;
+};
+
+static constexpr uint32_t NB_DECODE_ENTRIES = 0x10000;
+
+extern const std::array<DecodeEntry, NB_DECODE_ENTRIES> decodeTable;
+
+constexpr uint8_t opcodeToHandler(uint16_t opcode)
+{
+    switch (opcode)
+    {
+    case MAJOR_OPCODE_JNE_JNZ:
+    case MAJOR_OPCODE_JEQ_JZ:
+    case MAJOR_OPCODE_JNC:
+    case MAJOR_OPCODE_JC:
+    case MAJOR_OPCODE_JN:
+    case MAJOR_OPCODE_JGE:
+    case MAJOR_OPCODE_JL:
+    case MAJOR_OPCODE_JMP:
+        return DECODE_HANDLER_JUMP;
+    case MAJOR_OPCODE_MOV:
+        return DECODE_HANDLER_MOV;
+    case MAJOR_OPCODE_ADD:
+        return DECODE_HANDLER_ADD;
+    case MAJOR_OPCODE_ADDC:
+        return DECODE_HANDLER_ADDC;
+    case MAJOR_OPCODE_SUBC:
+        return DECODE_HANDLER_SUBC;
+    case MAJOR_OPCODE_SUB:
+        return DECODE_HANDLER_SUB;
+    case MAJOR_OPCODE_CMP:
+        return DECODE_HANDLER_CMP;
+    case MAJOR_OPCODE_DADD:
+        return DECODE_HANDLER_DADD;
+    case MAJOR_OPCODE_BIT:
+        return DECODE_HANDLER_BIT;
+    case MAJOR_OPCODE_BIC:
+        return DECODE_HANDLER_BIC;
+    case MAJOR_OPCODE_BIS:
+        return DECODE_HANDLER_BIS;
+    case MAJOR_OPCODE_XOR:
+        return DECODE_HANDLER_XOR;
+    case MAJOR_OPCODE_AND:
+        return DECODE_HANDLER_AND;
+    default:
+        return DECODE_HANDLER_GENERIC;
+    }
+}
+
+// Tells if an operand of the given word size is followed by an extension
+// word
+inline bool decodeOperandHasExtWord(const DecodeOperand &opd,
+                                    enum WORD_SIZE wordSize)
+{
+    uint8_t flag =
+        (wordSize == BYTE) ? DECODE_OPD_EXT_BYTE : DECODE_OPD_EXT_WIDE;
+    return (opd.flags & flag) != 0;
+}
+
+// Cycles of a format I instruction, indexed by source class (Rn or constant,
+// @Rn or @Rn+, #N, x(Rn) EDE or &EDE) then destination (Rm, PC, memory)
+static constexpr uint8_t formatICycles[4][3] = {
+    {1, 3, 4},
+    {2, 4, 5},
+    {2, 3, 5},
+    {3, 5, 6},
+};
+
+// Cycles of a format II instruction (RRC, SWPB, RRA, SXT), from the address
+// mode of its operand
+constexpr uint8_t formatIICycles(uint8_t mode)
+{
+    if (mode == ADDR_MODE_REGISTER)
+    {
+        return 1;
+    }
+    return ((mode == ADDR_MODE_INDEXED) || (mode == ADDR_MODE_SYMBOLIC) ||
+            (mode == ADDR_MODE_ABSOLUTE))
+               ? 4
+               : 3;
+}
+
+/**
+ * CPU cycles taken by an instruction, from the MSP430X CPU instruction
+ * cycle tables.
+ *
+ * The same function describes the decode table entries and the
+ * instructions decoded without it. An extension word (0x18/0x1C major
+ * opcode) costs one more cycle than the core instruction it prefixes.
+ * For PUSHM/POPM and RRxA/RRxX, srcValue is the count minus one.
+ */
+constexpr uint8_t instructionCycles(uint8_t majorOpcode, uint8_t format,
+                                    uint16_t minorOpcode, uint8_t handler,
+                                    uint8_t srcMode, bool srcConstant,
+                                    uint16_t srcValue, uint8_t dstMode,
+                                    uint8_t dstReg)
+{
+    uint8_t srcClass = 0;
+    uint8_t dstClass = 0;
+    uint8_t cycles = 0;
+
+    switch (majorOpcode)
+    {
+    case MAJOR_OPCODE_00:
+        switch (minorOpcode)
+        {
+        case MINOR_EXT00_MOVA_REGISTER:
+        case MINOR_EXT00_CMPA_REGISTER:
+        case MINOR_EXT00_ADDA_REGISTER:
+        case MINOR_EXT00_SUBA_REGISTER:
+            return 1;
+        case MINOR_EXT00_MOVA_IMMEDIATE:
+            return 2;
+        case MINOR_EXT00_MOVA_INDIRECT_REGISTER:
+        case MINOR_EXT00_MOVA_INDIRECT_AUTOINCREMENT:
+        case MINOR_EXT00_CMPA_IMMEDIATE:
+        case MINOR_EXT00_ADDA_IMMEDIATE:
+        case MINOR_EXT00_SUBA_IMMEDIATE:
+            return 3;
+        case MINOR_EXT00_RR_RL_A_OPCODE:
+        case MINOR_EXT00_RR_RL_W_OPCODE:
+            return srcValue + 1;
+        default:
+            return 4;
+        }
+    case MAJOR_OPCODE_10:
+        if (minorOpcode == MINOR_EXT10_RETI)
+        {
+            return 5;
+        }
+        if ((minorOpcode >= MINOR_EXT10_CALLA_REGISTER) &&
+            (minorOpcode <= MINOR_EXT10_CALLA_IMMEDIATE))
+        {
+            return ((srcMode == ADDR_MODE_ABSOLUTE) ||
+                    (srcMode == ADDR_MODE_SYMBOLIC))
+                       ? 6
+                       : 5;
+        }
+        return formatIICycles(srcMode);
+    case MAJOR_OPCODE_14:
+        // PUSHM.A and POPM.A move two words per register
+        return 2 + (srcValue + 1) * (((minorOpcode & 0x1) == 0) ? 2 : 1);
+    case MAJOR_OPCODE_18:
+    case MAJOR_OPCODE_1C:
+        // Extended format II instructions decode their operand as the
+        // destination
+        if (format == 2)
+        {
+            return 1 + formatIICycles(dstMode);
+        }
+        cycles = 1;
+        break;
+    default:
+        break;
+    }
+
+    if (format == 3)
+    {
+        return cycles + 2;
+    }
+
+    if (srcConstant || (srcMode == ADDR_MODE_REGISTER))
+    {
+        srcClass = 0;
+    }
+    else if ((srcMode == ADDR_MODE_INDIRECT_REGISTER) ||
+             (srcMode == ADDR_MODE_INDIRECT_AUTOINCREMENT))
+    {
+        srcClass = 1;
+    }
+    else if (srcMode == ADDR_MODE_IMMEDIATE)
+    {
+        srcClass = 2;
+    }
+    else
+    {
+        srcClass = 3;
+    }
+
+    if (dstMode != ADDR_MODE_REGISTER)
+    {
+        dstClass = 2;
+    }
+    else if (dstReg == 0)
+    {
+        dstClass = 1;
+    }
+    cycles += formatICycles[srcClass][dstClass];
+
+    // MOV, BIT and CMP to memory save the write back cycle
+    if ((dstClass == 2) &&
+        ((handler == DECODE_HANDLER_MOV) || (handler == DECODE_HANDLER_BIT) ||
+         (handler == DECODE_HANDLER_CMP)))
+    {
+        cycles--;
+    }
+    return cycles;
+}
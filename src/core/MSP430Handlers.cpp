@@ -0,0 +1,233 @@
+#include "MSP430.h"
+#include "MSP430DecodeTable.h"
+#include "MSP430Handlers.h"
+
+// Operand classes the handlers are specialized on
+static constexpr uint8_t OPD_CLASS_REGISTER = 0;
+static constexpr uint8_t OPD_CLASS_IMMEDIATE = 1;
+static constexpr uint8_t OPD_CLASS_MEMORY = 2;
+static constexpr uint8_t NB_SRC_CLASSES = 3;
+static constexpr uint8_t NB_DST_CLASSES = 2; // register or memory
+
+static constexpr uint8_t NB_OPERATIONS =
+    DECODE_HANDLER_AND - DECODE_HANDLER_MOV + 1;
+static constexpr uint8_t NB_WORD_SIZES = BYTE - _20B_WORD + 1;
+static constexpr size_t NB_FORMAT_I_HANDLERS =
+    NB_OPERATIONS * NB_SRC_CLASSES * NB_DST_CLASSES * NB_WORD_SIZES;
+
+static constexpr uint8_t operandClass(enum ADDRESSING_MODE addrMode)
+{
+    switch (addrMode)
+    {
+    case ADDR_MODE_REGISTER:
+        return OPD_CLASS_REGISTER;
+    case ADDR_MODE_IMMEDIATE:
+        return OPD_CLASS_IMMEDIATE;
+    default:
+        return OPD_CLASS_MEMORY;
+    }
+}
+
+static constexpr uint32_t wordSizeMask(enum WORD_SIZE wordSize)
+{
+    return (wordSize == BYTE) ? 0xFF
+                              : ((wordSize == WORD) ? 0xFFFF : 0x000FFFFF);
+}
+
+/**
+ * Writes the result to the destination and moves PC to the next
+ * instruction, as MSP430::instructionWrite() does.
+ */
+template <uint8_t DST, enum WORD_SIZE SIZE>
+inline void MSP430Handlers::writeDestination(MSP430 *cpu, Instruction *instr,
+                                             uint32_t value, bool alwaysIncPc)
+{
+    InstructionOperand *dst = &(instr->destination);
+
+    if constexpr (DST == OPD_CLASS_REGISTER)
+    {
+        // A full SR write drops the flags pending from a previous operation
+        if (dst->reg == MSP430::REG_IDX_SR)
+        {
+            cpu->flagsPending_ = false;
+        }
+        cpu->registers_[dst->reg] = value;
+        if (alwaysIncPc || (dst->reg != MSP430::REG_IDX_PC))
+        {
+            cpu->regIncPc();
+        }
+    }
+    else
+    {
+        if constexpr (SIZE == BYTE)
+        {
+            cpu->devicesManager_.writeByte(dst->address, value);
+        }
+        else if constexpr (SIZE == WORD)
+        {
+            cpu->devicesManager_.writeWord(dst->address, value);
+        }
+        else
+        {
+            cpu->devicesManager_.writeDWord(dst->address, value);
+        }
+        cpu->regIncPc();
+    }
+}
+
+/**
+ * Executes a format I instruction on resolved operands.
+ *
+ * Status flags are not computed here: the operands and result are recorded
+ * in MSP430::lazyFlags_ and the flags are only computed when SR is read.
+ */
+template <uint8_t OP, uint8_t SRC, uint8_t DST, enum WORD_SIZE SIZE>
+void MSP430Handlers::formatIHandler(MSP430 *cpu, Instruction *instr)
+{
+    constexpr uint32_t MASK = wordSizeMask(SIZE);
+    constexpr bool LOGICAL =
+        (OP == DECODE_HANDLER_BIT) || (OP == DECODE_HANDLER_BIC) ||
+        (OP == DECODE_HANDLER_BIS) || (OP == DECODE_HANDLER_XOR) ||
+        (OP == DECODE_HANDLER_AND);
+    const uint32_t src = instr->source.value;
+    const uint32_t dst = instr->destination.value;
+    bool dstIsSr = false;
+    uint32_t sr = 0;
+    uint32_t value = 0;
+
+    if constexpr (OP == DECODE_HANDLER_MOV)
+    {
+        // MOV #0, SR is the NOP emulated instruction
+        if constexpr ((SRC == OPD_CLASS_IMMEDIATE) &&
+                      (DST == OPD_CLASS_REGISTER))
+        {
+            if ((src == 0) && (instr->destination.reg == MSP430::REG_IDX_SR))
+            {
+                return;
+            }
+        }
+        writeDestination<DST, SIZE>(cpu, instr, src, false);
+        return;
+    }
+
+    // An arithmetic result written to SR is replaced by the status computed
+    // from SR as it was before the write
+    if constexpr ((DST == OPD_CLASS_REGISTER) && !LOGICAL)
+    {
+        dstIsSr = (instr->destination.reg == MSP430::REG_IDX_SR);
+        if (dstIsSr)
+        {
+            sr = cpu->getRegister(MSP430::REG_IDX_SR);
+        }
+    }
+
+    if constexpr ((OP == DECODE_HANDLER_ADD) || (OP == DECODE_HANDLER_ADDC))
+    {
+        value = dst + src;
+        if constexpr (OP == DECODE_HANDLER_ADDC)
+        {
+            value += cpu->getStatusRegister().status.carry;
+        }
+    }
+    else if constexpr ((OP == DECODE_HANDLER_SUB) ||
+                       (OP == DECODE_HANDLER_SUBC))
+    {
+        value = (dst - src) & MASK;
+        if constexpr (OP == DECODE_HANDLER_SUBC)
+        {
+            value -= (1 - cpu->getStatusRegister().status.carry);
+        }
+    }
+    else if constexpr (OP == DECODE_HANDLER_CMP)
+    {
+        value = dst - src;
+    }
+    else if constexpr (OP == DECODE_HANDLER_DADD)
+    {
+        value = cpu->addBCD(instr);
+    }
+    else if constexpr (OP == DECODE_HANDLER_BIC)
+    {
+        value = dst & ~src;
+    }
+    else if constexpr (OP == DECODE_HANDLER_BIS)
+    {
+        value = dst | src;
+    }
+    else if constexpr (OP == DECODE_HANDLER_XOR)
+    {
+        value = dst ^ src;
+    }
+    else
+    {
+        value = dst & src; // AND, BIT
+    }
+
+    if constexpr (OP == DECODE_HANDLER_CMP)
+    {
+        cpu->regIncPc();
+    }
+    else
+    {
+        writeDestination<DST, SIZE>(cpu, instr, value);
+    }
+
+    // BIC and BIS leave the status register untouched
+    if constexpr ((OP == DECODE_HANDLER_BIC) || (OP == DECODE_HANDLER_BIS))
+    {
+        return;
+    }
+
+    if (dstIsSr)
+    {
+        cpu->registers_[MSP430::REG_IDX_SR] = sr;
+    }
+    cpu->lazyFlags_ = {OP, value, src, dst, MASK};
+    cpu->flagsPending_ = true;
+}
+
+template <size_t INDEX> constexpr OpHandler MSP430Handlers::handlerAt()
+{
+    constexpr uint8_t OP = DECODE_HANDLER_MOV +
+                           INDEX / (NB_SRC_CLASSES * NB_DST_CLASSES *
+                                    NB_WORD_SIZES);
+    constexpr uint8_t SRC =
+        (INDEX / (NB_DST_CLASSES * NB_WORD_SIZES)) % NB_SRC_CLASSES;
+    constexpr uint8_t DST = ((INDEX / NB_WORD_SIZES) % NB_DST_CLASSES)
+                                ? OPD_CLASS_MEMORY
+                                : OPD_CLASS_REGISTER;
+    constexpr enum WORD_SIZE SIZE =
+        (enum WORD_SIZE)(_20B_WORD + INDEX % NB_WORD_SIZES);
+
+    return &formatIHandler<OP, SRC, DST, SIZE>;
+}
+
+template <size_t... INDEXES>
+constexpr auto MSP430Handlers::makeHandlers(std::index_sequence<INDEXES...>)
+{
+    return std::array<OpHandler, NB_FORMAT_I_HANDLERS>{
+        {handlerAt<INDEXES>()...}};
+}
+
+OpHandler MSP430Handlers::select(const Instruction &instr)
+{
+    static constexpr std::array<OpHandler, NB_FORMAT_I_HANDLERS> handlers =
+        makeHandlers(std::make_index_sequence<NB_FORMAT_I_HANDLERS>());
+    const InstructionOperand &src = instr.source;
+    const InstructionOperand &dst = instr.destination;
+
+    if ((instr.handler < DECODE_HANDLER_MOV) ||
+        (src.wordSize != dst.wordSize) || (src.wordSize == __RESERVED))
+    {
+        return nullptr;
+    }
+
+    // Same layout as handlerAt(): operation, source class, destination
+    // class (register or memory) and word size
+    size_t index = instr.handler - DECODE_HANDLER_MOV;
+    index = index * NB_SRC_CLASSES + operandClass(src.addrMode);
+    index = index * NB_DST_CLASSES +
+            ((operandClass(dst.addrMode) == OPD_CLASS_REGISTER) ? 0 : 1);
+    index = index * NB_WORD_SIZES + (src.wordSize - _20B_WORD);
+    return handlers[index];
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <utility>
+
+#include "MSP430BlockCache.h"
+#include "MSP430InstructionHelper.h"
+
+/**
+ * Format I execute handlers specialized at compile time.
+ *
+ * One handler is generated per (operation, source operand class,
+ * destination operand class, word size), so masks, sign bits, the
+ * destination write path and the flag computations are constants in each
+ * of them. Handlers run on resolved operands, like the generic
+ * run*Instruction() methods they replace on the block dispatch path.
+ */
+struct MSP430Handlers
+{
+    // Returns nullptr if the instruction has no specialized handler
+    static OpHandler select(const Instruction &instr);
+
+private:
+    template <uint8_t DST, enum WORD_SIZE SIZE>
+    static void writeDestination(MSP430 *cpu, Instruction *instr,
+                                 uint32_t value, bool alwaysIncPc = true);
+    template <uint8_t OP, uint8_t SRC, uint8_t DST, enum WORD_SIZE SIZE>
+    static void formatIHandler(MSP430 *cpu, Instruction *instr);
+    template <size_t INDEX> static constexpr OpHandler handlerAt();
+    template <size_t... INDEXES>
+    static constexpr auto makeHandlers(std::index_sequence<INDEXES...>);
+};
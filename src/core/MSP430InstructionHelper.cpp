@@ -7,6 +7,7 @@
 #include <stdio.h>
 
 #include "MSP430InstructionHelper.h"
+#include "MSP430Trace.h"
 
 using namespace std;
 
@@ -96,7 +97,8 @@ static const char *wordSizeStr(enum WORD_SIZE wordSize)
 
 static void printOperand(const char *operandStr, const InstructionOperand *opd)
 {
-    printf(
+    TRACE_DEBUG(
+        TRACE_DECODE,
         "%s:[adm:%s size=%s value:%X CG=%d reg=%d addr=%X axFlag=%X nu=%d]\n",
         operandStr, addressingModeStr(opd->addrMode),
         wordSizeStr(opd->wordSize), opd->value, opd->usedConstantGenerator,
@@ -105,8 +107,9 @@ static void printOperand(const char *operandStr, const InstructionOperand *opd)
 
 void printInstruction(const Instruction *i)
 {
-    printf("%X:%X format:%d ext:%d rep:%d %X\n", i->majorOpcode, i->minorOpcode,
-           i->format, i->extended, i->repetition, i->rawInstruction[0]);
+    TRACE_DEBUG(TRACE_DECODE, "%X:%X format:%d ext:%d rep:%d %X\n",
+                i->majorOpcode, i->minorOpcode, i->format, i->extended,
+                i->repetition, i->rawInstruction[0]);
 
     printOperand("src", &(i->source));
     printOperand("dst", &(i->destination));
@@ -224,6 +227,36 @@ uint8_t opcodeToFormat(uint8_t opcode)
     }
 }
 
+/**
+ * Computes the PC offset of a jump instruction.
+ *
+ * The offset is a signed 10-bit word count, relative to the word following
+ * the jump: the jump target is the jump address + the returned offset.
+ */
+int jumpOffset(uint16_t rawInstruction)
+{
+    int offset;
+
+    // dst->value is a 10-bit value from the instruction, so we mask it
+    // with 0x3FF to ensure it's indeed 10 bits
+    uint16_t rawOffset = rawInstruction & 0x3FF;
+
+    // Check if the most significant bit (bit 9) is set
+    if (rawOffset & 0x200)
+    {
+        // This is a negative offset; convert it to a signed 10-bit integer
+        offset = rawOffset - 0x400; // Equivalent to taking two's complement
+    }
+    else
+    {
+        // This is a positive offset
+        offset = rawOffset;
+    }
+
+    // Convert the 10-bit offset to a byte offset and add 2
+    return (offset * 2) + 2;
+}
+
 uint32_t getValueFromConstantGenerator(uint32_t source, uint8_t asFlag)
 {
     /* R3 */
@@ -36,6 +36,7 @@ typedef struct
     bool processAsSource; //
     uint16_t additionalRawInstruction; // if applicable
     bool usedConstantGenerator;        // for debuging purpose
+    uint8_t pcOffset; // PC offset from the instruction when resolved
 } InstructionOperand;
 
 // major opcode
@@ -109,6 +110,9 @@ typedef struct InstructionStruct
 
     // Internal data.
     uint8_t format : 2;         // Instruction format (I, II or III)
+    uint8_t handler;            // execute handler (enum DECODE_HANDLER)
+    uint8_t size;               // Instruction size in bytes
+    uint8_t cycles;             // CPU cycles of one execution
     uint16_t rawInstruction[4]; // Raw instruction word
 } Instruction;
 
@@ -127,3 +131,4 @@ enum ADDRESSING_MODE asFlagToAddrMode(Instruction *instr);
 uint32_t getValueFromConstantGenerator(uint32_t source, uint8_t asFlag);
 
 uint8_t opcodeToFormat(uint8_t opcode);
+int jumpOffset(uint16_t rawInstruction);
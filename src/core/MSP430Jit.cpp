@@ -0,0 +1,749 @@
+#include <assert.h>
+#include <string.h>
+
+#include "MSP430.h"
+#include "MSP430Handlers.h"
+#include "MSP430Jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define MSP430_JIT_X86_64 1
+#include <sys/mman.h>
+#endif
+
+// Host registers, numbered as in ModRM
+static constexpr uint8_t RAX = 0;
+static constexpr uint8_t RCX = 1;
+static constexpr uint8_t RDX = 2;
+static constexpr uint8_t RBX = 3;
+static constexpr uint8_t RSP = 4;
+static constexpr uint8_t RSI = 6;
+static constexpr uint8_t RDI = 7;
+static constexpr uint8_t R8 = 8;
+static constexpr uint8_t R9 = 9;
+static constexpr uint8_t R12 = 12;
+static constexpr uint8_t R13 = 13;
+static constexpr uint8_t R14 = 14;
+static constexpr uint8_t NO_INDEX = 0xFF;
+
+// Operand size of an encoded instruction, 32 bits by default
+static constexpr uint8_t OP_WIDE = 1; // 64 bits, REX.W
+static constexpr uint8_t OP_16 = 2;   // 16 bits, 0x66 prefix
+
+// Jcc condition codes
+static constexpr uint8_t CC_AE = 0x3;
+static constexpr uint8_t CC_E = 0x4;
+static constexpr uint8_t CC_A = 0x7;
+static constexpr uint8_t CC_ALWAYS = 0xFF;
+
+static uint32_t wordSizeMask(enum WORD_SIZE wordSize)
+{
+    switch (wordSize)
+    {
+    case _20B_WORD:
+        return 0x000FFFFF;
+    case WORD:
+        return 0xFFFF;
+    case BYTE:
+        return 0xFF;
+    default:
+        assert(0);
+        return 0;
+    };
+}
+
+MSP430Jit::MSP430Jit(const JitCallbacks &callbacks, const JitLayout &layout)
+    : callbacks_(callbacks), layout_(layout), codeBuffer_(nullptr),
+      codeUsed_(0), failed_(false)
+{
+}
+
+MSP430Jit::~MSP430Jit()
+{
+#ifdef MSP430_JIT_X86_64
+    if (codeBuffer_ != nullptr)
+    {
+        munmap(codeBuffer_, CODE_BUFFER_SIZE);
+    }
+#endif
+}
+
+bool MSP430Jit::isSupported()
+{
+#ifdef MSP430_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MSP430Jit::prepare()
+{
+#ifdef MSP430_JIT_X86_64
+    if (failed_)
+    {
+        return false;
+    }
+    if (codeBuffer_ == nullptr)
+    {
+        void *buffer = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_EXEC,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED)
+        {
+            failed_ = true;
+            return false;
+        }
+        codeBuffer_ = (uint8_t *) buffer;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MSP430Jit::reset() { codeUsed_ = 0; }
+
+void MSP430Jit::emit8(uint8_t byte) { code_.push_back(byte); }
+
+void MSP430Jit::emit32(uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        emit8((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void MSP430Jit::emit64(uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        emit8((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void MSP430Jit::emitRex(uint8_t flags, uint8_t reg, uint8_t index,
+                        uint8_t base)
+{
+    uint8_t rex = 0x40;
+
+    rex |= (flags & OP_WIDE) ? 0x08 : 0;
+    rex |= (reg & 0x8) ? 0x04 : 0;
+    rex |= ((index != NO_INDEX) && (index & 0x8)) ? 0x02 : 0;
+    rex |= (base & 0x8) ? 0x01 : 0;
+    if (rex != 0x40)
+    {
+        emit8(rex);
+    }
+}
+
+// Prefixes and opcode (one byte, or two with 0x0F) of an instruction
+void MSP430Jit::emitOpcode(uint8_t flags, uint16_t opcode, uint8_t reg,
+                           uint8_t index, uint8_t base)
+{
+    if (flags & OP_16)
+    {
+        emit8(0x66);
+    }
+    emitRex(flags, reg, index, base);
+    if (opcode > 0xFF)
+    {
+        emit8(opcode >> 8);
+    }
+    emit8(opcode & 0xFF);
+}
+
+// Instruction on [base + index * 8 + disp]; reg is the register operand or
+// the opcode extension
+void MSP430Jit::emitMemOp(uint8_t flags, uint16_t opcode, uint8_t reg,
+                          uint8_t base, uint8_t index, int32_t disp)
+{
+    emitOpcode(flags, opcode, reg, index, base);
+    if (index == NO_INDEX)
+    {
+        emit8(0x80 | ((reg & 0x7) << 3) | (base & 0x7));
+        if ((base & 0x7) == RSP)
+        {
+            emit8(0x24);
+        }
+    }
+    else
+    {
+        emit8(0x80 | ((reg & 0x7) << 3) | RSP);
+        emit8(0xC0 | ((index & 0x7) << 3) | (base & 0x7));
+    }
+    emit32(disp);
+}
+
+// Instruction on two registers, rm being the ModRM r/m operand
+void MSP430Jit::emitRegOp(uint8_t flags, uint16_t opcode, uint8_t reg,
+                          uint8_t rm)
+{
+    emitOpcode(flags, opcode, reg, NO_INDEX, rm);
+    emit8(0xC0 | ((reg & 0x7) << 3) | (rm & 0x7));
+}
+
+// ADD (0), OR (1), AND (4), SUB (5), XOR (6) or CMP (7) rm, imm32
+void MSP430Jit::emitAluImm(uint8_t flags, uint8_t ext, uint8_t rm,
+                           uint32_t value)
+{
+    emitRegOp(flags, 0x81, ext, rm);
+    emit32(value);
+}
+
+void MSP430Jit::emitMovImm(uint8_t reg, uint32_t value)
+{
+    emitRex(0, 0, NO_INDEX, reg);
+    emit8(0xB8 | (reg & 0x7));
+    emit32(value);
+}
+
+// Forward jump, its rel32 is recorded in fixups to be patched
+void MSP430Jit::emitJcc(uint8_t condition, std::vector<size_t> &fixups)
+{
+    emit8(0x0F), emit8(0x80 | condition);
+    fixups.push_back(code_.size());
+    emit32(0);
+}
+
+// Jump to an already emitted target
+void MSP430Jit::emitJump(uint8_t condition, size_t target)
+{
+    if (condition == CC_ALWAYS)
+    {
+        emit8(0xE9);
+    }
+    else
+    {
+        emit8(0x0F), emit8(0x80 | condition);
+    }
+    emit32(target - (code_.size() + 4));
+}
+
+static bool isPlainRegister(uint8_t reg)
+{
+    return (reg == MSP430::REG_IDX_SP) || (reg > MSP430::REG_IDX_CG2);
+}
+
+/**
+ * Tells if an op can be translated to host code.
+ *
+ * Format I MOV, ADD, SUB, CMP, BIT, BIC, BIS, XOR and AND run by their
+ * specialized handler are translated, unless they read or write PC or SR.
+ * Word and byte operations can use any addressing mode; extended ones
+ * (without repetition) only register and immediate operands.
+ */
+bool MSP430Jit::canTranslate(const BlockOp &op) const
+{
+    const Instruction &instr = op.instr;
+    const InstructionOperand &src = instr.source;
+    const InstructionOperand &dst = instr.destination;
+
+    if (instr.extended &&
+        ((instr.majorOpcode != MAJOR_OPCODE_18) || instr.repetition ||
+         (instr.rawInstruction[0] & 0x80)))
+    {
+        return false;
+    }
+
+    switch (instr.handler)
+    {
+    case DECODE_HANDLER_MOV:
+    case DECODE_HANDLER_ADD:
+    case DECODE_HANDLER_SUB:
+    case DECODE_HANDLER_CMP:
+    case DECODE_HANDLER_BIT:
+    case DECODE_HANDLER_BIC:
+    case DECODE_HANDLER_BIS:
+    case DECODE_HANDLER_XOR:
+    case DECODE_HANDLER_AND:
+        break;
+    default:
+        return false;
+    }
+    if ((instr.format != 1) || (op.handler != MSP430Handlers::select(instr)))
+    {
+        return false;
+    }
+
+    bool memory = !instr.extended &&
+                  ((src.wordSize == WORD) || (src.wordSize == BYTE));
+
+    switch (src.addrMode)
+    {
+    case ADDR_MODE_IMMEDIATE:
+        break;
+    case ADDR_MODE_REGISTER:
+        if (!isPlainRegister(src.reg))
+        {
+            return false;
+        }
+        break;
+    case ADDR_MODE_ABSOLUTE:
+    case ADDR_MODE_SYMBOLIC:
+        if (!memory)
+        {
+            return false;
+        }
+        break;
+    case ADDR_MODE_INDEXED:
+    case ADDR_MODE_INDIRECT_REGISTER:
+    case ADDR_MODE_INDIRECT_AUTOINCREMENT:
+        if (!memory || !isPlainRegister(src.reg))
+        {
+            return false;
+        }
+        break;
+    default:
+        return false;
+    }
+
+    switch (dst.addrMode)
+    {
+    case ADDR_MODE_REGISTER:
+        return isPlainRegister(dst.reg);
+    case ADDR_MODE_ABSOLUTE:
+    case ADDR_MODE_SYMBOLIC:
+        return memory;
+    case ADDR_MODE_INDEXED:
+        return memory && isPlainRegister(dst.reg);
+    default:
+        return false;
+    }
+}
+
+/**
+ * Emits the address of a memory operand in hostReg. increment is added to
+ * the base register, for a destination seeing the autoincrement of the
+ * source.
+ */
+void MSP430Jit::emitOperandAddress(const InstructionOperand &opd, uint32_t pc,
+                                   uint8_t hostReg, uint32_t increment)
+{
+    uint32_t offset = increment;
+
+    switch (opd.addrMode)
+    {
+    case ADDR_MODE_ABSOLUTE:
+        emitMovImm(hostReg, opd.value);
+        return;
+    case ADDR_MODE_SYMBOLIC:
+        emitMovImm(hostReg, pc + opd.pcOffset + opd.value);
+        return;
+    case ADDR_MODE_INDEXED:
+        offset += opd.value;
+        break;
+    default:
+        break;
+    }
+
+    // mov hostReg, [rbx + reg]; add hostReg, offset
+    emitMemOp(0, 0x8B, hostReg, RBX, NO_INDEX, opd.reg * sizeof(uint32_t));
+    if (offset != 0)
+    {
+        emitAluImm(0, 0, hostReg, offset);
+    }
+}
+
+/**
+ * Emits the lookup of the host address of nbBytes at the bus address in
+ * addressReg, from the page table at offset table of the registers. The
+ * address is left in pointerReg; pages without data and accesses crossing
+ * a page jump to the slow path. Uses rdx.
+ */
+void MSP430Jit::emitPageLookup(uint8_t addressReg, uint8_t pointerReg,
+                               int32_t table, uint8_t nbBytes, SlowPath &slow)
+{
+    // mov edx, address; shr edx, PAGE_SHIFT; cmp edx, NB_PAGES; jae slow
+    emitRegOp(0, 0x89, addressReg, RDX);
+    emitRegOp(0, 0xC1, 5, RDX), emit8(DevicesManager::PAGE_SHIFT);
+    emitAluImm(0, 7, RDX, DevicesManager::NB_PAGES);
+    emitJcc(CC_AE, slow.fixups);
+
+    // mov pointer, [rbx + table + rdx * 8]; test pointer, pointer; jz slow
+    emitMemOp(OP_WIDE, 0x8B, pointerReg, RBX, RDX, table);
+    emitRegOp(OP_WIDE, 0x85, pointerReg, pointerReg);
+    emitJcc(CC_E, slow.fixups);
+
+    // mov edx, address; and edx, PAGE_MASK; cmp edx, PAGE_SIZE - nbBytes;
+    // ja slow; add pointer, rdx
+    emitRegOp(0, 0x89, addressReg, RDX);
+    emitAluImm(0, 4, RDX, DevicesManager::PAGE_MASK);
+    emitAluImm(0, 7, RDX, DevicesManager::PAGE_SIZE - nbBytes);
+    emitJcc(CC_A, slow.fixups);
+    emitRegOp(OP_WIDE, 0x01, RDX, pointerReg);
+}
+
+/**
+ * Emits the host code of a translated op, rbx pointing to the registers.
+ *
+ * Same computation as the specialized handlers: the source (eax) and the
+ * destination (ecx) are masked to the word size, the result (edx) is
+ * written unmasked to registers and truncated to memory, and the flags are
+ * left pending. Memory operands are looked up before anything is changed,
+ * so that the slow path can run the whole op through the interpreter.
+ * count and cycles are the native instructions before the op not
+ * accounted yet.
+ */
+void MSP430Jit::emitTranslatedOp(BlockOp &op, uint32_t pc, uint32_t count,
+                                 uint32_t cycles)
+{
+    const Instruction &instr = op.instr;
+    const InstructionOperand &src = instr.source;
+    const InstructionOperand &dst = instr.destination;
+    uint8_t handler = instr.handler;
+    uint32_t mask = wordSizeMask(src.wordSize);
+    uint8_t nbBytes = (src.wordSize == BYTE) ? 1 : 2;
+    bool srcMemory = (src.addrMode != ADDR_MODE_REGISTER) &&
+                     (src.addrMode != ADDR_MODE_IMMEDIATE);
+    bool dstMemory = (dst.addrMode != ADDR_MODE_REGISTER);
+    bool writes =
+        (handler != DECODE_HANDLER_CMP) && (handler != DECODE_HANDLER_BIT);
+    uint32_t increment =
+        (src.addrMode == ADDR_MODE_INDIRECT_AUTOINCREMENT) ? nbBytes : 0;
+    SlowPath slow = {&op, pc, count, cycles, {}, 0};
+
+    if (srcMemory)
+    {
+        emitOperandAddress(src, pc, RSI, 0);
+        emitPageLookup(RSI, R8, layout_.pageReadData, nbBytes, slow);
+    }
+    if (dstMemory)
+    {
+        bool sameBase = (dst.addrMode == ADDR_MODE_INDEXED) &&
+                        (dst.reg == src.reg);
+        emitOperandAddress(dst, pc, RDI, sameBase ? increment : 0);
+        emitPageLookup(RDI, R9,
+                       writes ? layout_.pageWriteData : layout_.pageReadData,
+                       nbBytes, slow);
+    }
+    if (increment != 0)
+    {
+        // add dword [rbx + src], increment
+        emitMemOp(0, 0x81, 0, RBX, NO_INDEX, src.reg * sizeof(uint32_t));
+        emit32(increment);
+    }
+
+    // eax = source
+    if (src.addrMode == ADDR_MODE_IMMEDIATE)
+    {
+        emitMovImm(RAX, src.value);
+    }
+    else if (src.addrMode == ADDR_MODE_REGISTER)
+    {
+        emitMemOp(0, 0x8B, RAX, RBX, NO_INDEX, src.reg * sizeof(uint32_t));
+        emitAluImm(0, 4, RAX, mask);
+    }
+    else
+    {
+        // movzx eax, byte/word [r8]
+        emitMemOp(0, (nbBytes == 1) ? 0x0FB6 : 0x0FB7, RAX, R8, NO_INDEX, 0);
+    }
+
+    // ecx = destination, edx = result
+    if (handler == DECODE_HANDLER_MOV)
+    {
+        emitRegOp(0, 0x89, RAX, RDX);
+    }
+    else
+    {
+        if (dstMemory)
+        {
+            emitMemOp(0, (nbBytes == 1) ? 0x0FB6 : 0x0FB7, RCX, R9, NO_INDEX,
+                      0);
+        }
+        else
+        {
+            emitMemOp(0, 0x8B, RCX, RBX, NO_INDEX,
+                      dst.reg * sizeof(uint32_t));
+            emitAluImm(0, 4, RCX, mask);
+        }
+        emitRegOp(0, 0x89, RCX, RDX);
+
+        switch (handler)
+        {
+        case DECODE_HANDLER_ADD:
+            emitRegOp(0, 0x01, RAX, RDX);
+            break;
+        case DECODE_HANDLER_SUB:
+            emitRegOp(0, 0x29, RAX, RDX);
+            emitAluImm(0, 4, RDX, mask);
+            break;
+        case DECODE_HANDLER_CMP:
+            emitRegOp(0, 0x29, RAX, RDX);
+            break;
+        case DECODE_HANDLER_BIC:
+            // not eax; and edx, eax (BIC records no flags)
+            emitRegOp(0, 0xF7, 2, RAX);
+            emitRegOp(0, 0x21, RAX, RDX);
+            break;
+        case DECODE_HANDLER_BIS:
+            emitRegOp(0, 0x09, RAX, RDX);
+            break;
+        case DECODE_HANDLER_XOR:
+            emitRegOp(0, 0x31, RAX, RDX);
+            break;
+        default: // AND, BIT
+            emitRegOp(0, 0x21, RAX, RDX);
+            break;
+        }
+    }
+
+    if (writes && dstMemory)
+    {
+        // mov byte/word [r9], dl/dx
+        emitMemOp((nbBytes == 1) ? 0 : OP_16, (nbBytes == 1) ? 0x88 : 0x89,
+                  RDX, R9, NO_INDEX, 0);
+    }
+    else if (writes)
+    {
+        emitMemOp(0, 0x89, RDX, RBX, NO_INDEX, dst.reg * sizeof(uint32_t));
+    }
+
+    if ((handler != DECODE_HANDLER_MOV) && (handler != DECODE_HANDLER_BIC) &&
+        (handler != DECODE_HANDLER_BIS))
+    {
+        emitMemOp(0, 0xC6, 0, RBX, NO_INDEX, layout_.flagsOp), emit8(handler);
+        emitMemOp(0, 0x89, RDX, RBX, NO_INDEX, layout_.flagsResult);
+        emitMemOp(0, 0x89, RAX, RBX, NO_INDEX, layout_.flagsSrc);
+        emitMemOp(0, 0x89, RCX, RBX, NO_INDEX, layout_.flagsDst);
+        emitMemOp(0, 0xC7, 0, RBX, NO_INDEX, layout_.flagsMask), emit32(mask);
+        emitMemOp(0, 0xC6, 0, RBX, NO_INDEX, layout_.flagsPending), emit8(1);
+    }
+
+    if (!slow.fixups.empty())
+    {
+        slow.resume = code_.size();
+        slowPaths_.push_back(std::move(slow));
+    }
+}
+
+/**
+ * Emits a call to the interpreter for one op, leaving the block if the op
+ * invalidated it.
+ */
+void MSP430Jit::emitCallOp(Block *block, BlockOp *op)
+{
+    // mov rdi, r12; mov rsi, block; mov rdx, op
+    emit8(0x4C), emit8(0x89), emit8(0xE7);
+    emit8(0x48), emit8(0xBE), emit64((uint64_t) block);
+    emit8(0x48), emit8(0xBA), emit64((uint64_t) op);
+    // mov rax, executeOp; call rax
+    emit8(0x48), emit8(0xB8), emit64((uint64_t) callbacks_.executeOp);
+    emit8(0xFF), emit8(0xD0);
+    // test al, al; jz exit
+    emit8(0x84), emit8(0xC0);
+    emit8(0x0F), emit8(0x84);
+    exitFixups_.push_back(code_.size());
+    emit32(0);
+}
+
+/**
+ * Emits the accounting of the native instructions run since the previous
+ * one, and sets PC to pc. r13/r14 hold the part of count/cycles already
+ * accounted by slow paths. The block is left if the device events fired
+ * make an interrupt ready.
+ */
+void MSP430Jit::emitAccount(uint32_t pc, uint32_t count, uint32_t cycles)
+{
+    // mov dword [rbx], pc
+    emitMemOp(0, 0xC7, 0, RBX, NO_INDEX, 0), emit32(pc);
+    // mov rdi, r12; mov esi, count; sub esi, r13d; mov edx, cycles;
+    // sub edx, r14d
+    emitRegOp(OP_WIDE, 0x89, R12, RDI);
+    emitMovImm(RSI, count);
+    emitRegOp(0, 0x29, R13, RSI);
+    emitMovImm(RDX, cycles);
+    emitRegOp(0, 0x29, R14, RDX);
+    // mov rax, account; call rax; test al, al; jz exit
+    emit8(0x48), emit8(0xB8), emit64((uint64_t) callbacks_.account);
+    emit8(0xFF), emit8(0xD0);
+    emit8(0x84), emit8(0xC0);
+    emitJcc(CC_E, exitFixups_);
+    // xor r13d, r13d; xor r14d, r14d
+    emitRegOp(0, 0x31, R13, R13);
+    emitRegOp(0, 0x31, R14, R14);
+}
+
+/**
+ * Emits the slow path of a translated op: the native instructions before it
+ * are accounted, the op runs through the interpreter, and r13/r14 record
+ * that the op is accounted too before resuming after its native code.
+ */
+void MSP430Jit::emitSlowPath(Block *block, const SlowPath &slow)
+{
+    for (size_t fixup : slow.fixups)
+    {
+        uint32_t rel = code_.size() - (fixup + 4);
+        memcpy(&code_[fixup], &rel, sizeof(rel));
+    }
+
+    if (slow.count > 0)
+    {
+        emitAccount(slow.pc, slow.count, slow.cycles);
+    }
+    else
+    {
+        emitMemOp(0, 0xC7, 0, RBX, NO_INDEX, 0), emit32(slow.pc);
+    }
+    emitCallOp(block, slow.op);
+
+    // mov r13d, count + 1; mov r14d, cycles + op cycles; jmp resume
+    emitMovImm(R13, slow.count + 1);
+    emitMovImm(R14, slow.cycles + slow.op->instr.cycles);
+    emitJump(CC_ALWAYS, slow.resume);
+}
+
+/**
+ * Emits the check, after a translated op, that the CPU time has not reached
+ * the next device event. count and cycles are the native instructions run
+ * so far, the op included, and pc the address of the next op.
+ */
+void MSP430Jit::emitEventCheck(uint32_t pc, uint32_t count, uint32_t cycles)
+{
+    EventStub stub = {pc, count, cycles, {}, 0};
+
+    // mov rax, [rbx + cycles]; add rax, cycles; sub rax, r14;
+    // cmp rax, [rbx + nextEvent]; jae stub
+    emitMemOp(OP_WIDE, 0x8B, RAX, RBX, NO_INDEX, layout_.cycles);
+    emitAluImm(OP_WIDE, 0, RAX, cycles);
+    emitRegOp(OP_WIDE, 0x29, R14, RAX);
+    emitMemOp(OP_WIDE, 0x3B, RAX, RBX, NO_INDEX, layout_.nextEvent);
+    emitJcc(CC_AE, stub.fixups);
+    stub.resume = code_.size();
+    eventStubs_.push_back(std::move(stub));
+}
+
+/**
+ * Emits the stub accounting the native instructions once the next device
+ * event is due: the events fire, and the block is left if they made an
+ * interrupt ready, as the interpreter would after the same op.
+ */
+void MSP430Jit::emitEventStub(const EventStub &stub)
+{
+    for (size_t fixup : stub.fixups)
+    {
+        uint32_t rel = code_.size() - (fixup + 4);
+        memcpy(&code_[fixup], &rel, sizeof(rel));
+    }
+
+    emitAccount(stub.pc, stub.count, stub.cycles);
+
+    // mov r13d, count; mov r14d, cycles; jmp resume
+    emitMovImm(R13, stub.count);
+    emitMovImm(R14, stub.cycles);
+    emitJump(CC_ALWAYS, stub.resume);
+}
+
+/**
+ * Translates a block to host code.
+ *
+ * Consecutive translated ops run without leaving host code; PC and the
+ * executed instruction and cycle counts are only updated at the end of such
+ * a run, before the next interpreted op or the block exit, or when the run
+ * reaches the next device event.
+ */
+JitBlockFn MSP430Jit::compile(Block *block)
+{
+#ifdef MSP430_JIT_X86_64
+    uint32_t pc = block->startPc;
+    uint32_t nativeCount = 0;
+    uint32_t nativeCycles = 0;
+
+    if (!prepare())
+    {
+        return nullptr;
+    }
+    code_.clear();
+    exitFixups_.clear();
+    slowPaths_.clear();
+    eventStubs_.clear();
+
+    // push rbx; push r12; push r13; push r14; push r15 (keeps the stack
+    // 16-byte aligned)
+    emit8(0x53);
+    emit8(0x41), emit8(0x54);
+    emit8(0x41), emit8(0x55);
+    emit8(0x41), emit8(0x56);
+    emit8(0x41), emit8(0x57);
+    // mov rbx, rdi (registers); mov r12, rsi (cpu); xor r13d, r13d;
+    // xor r14d, r14d
+    emit8(0x48), emit8(0x89), emit8(0xFB);
+    emit8(0x49), emit8(0x89), emit8(0xF4);
+    emitRegOp(0, 0x31, R13, R13);
+    emitRegOp(0, 0x31, R14, R14);
+
+    for (BlockOp &op : block->ops)
+    {
+        if (canTranslate(op))
+        {
+            emitTranslatedOp(op, pc, nativeCount, nativeCycles);
+            nativeCount++;
+            nativeCycles += op.instr.cycles;
+            emitEventCheck(pc + op.instr.size, nativeCount, nativeCycles);
+        }
+        else
+        {
+            if (nativeCount > 0)
+            {
+                emitAccount(pc, nativeCount, nativeCycles);
+                nativeCount = 0;
+                nativeCycles = 0;
+            }
+            emitCallOp(block, &op);
+        }
+        pc += op.instr.size;
+    }
+
+    if (nativeCount > 0)
+    {
+        emitAccount(pc, nativeCount, nativeCycles);
+    }
+
+    // exit: pop r15; pop r14; pop r13; pop r12; pop rbx; ret
+    size_t exit = code_.size();
+    emit8(0x41), emit8(0x5F);
+    emit8(0x41), emit8(0x5E);
+    emit8(0x41), emit8(0x5D);
+    emit8(0x41), emit8(0x5C);
+    emit8(0x5B);
+    emit8(0xC3);
+
+    for (const SlowPath &slow : slowPaths_)
+    {
+        emitSlowPath(block, slow);
+    }
+    for (const EventStub &stub : eventStubs_)
+    {
+        emitEventStub(stub);
+    }
+    for (size_t fixup : exitFixups_)
+    {
+        uint32_t rel = exit - (fixup + 4);
+        memcpy(&code_[fixup], &rel, sizeof(rel));
+    }
+
+    if (codeUsed_ + code_.size() > CODE_BUFFER_SIZE)
+    {
+        return nullptr;
+    }
+
+    // Keep the buffer W^X, it is only writable while copying the code. If
+    // it cannot be made executable again, no translated code may run.
+    uint8_t *entry = codeBuffer_ + codeUsed_;
+    if (mprotect(codeBuffer_, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE) != 0)
+    {
+        failed_ = true;
+        return nullptr;
+    }
+    memcpy(entry, code_.data(), code_.size());
+    if (mprotect(codeBuffer_, CODE_BUFFER_SIZE, PROT_READ | PROT_EXEC) != 0)
+    {
+        failed_ = true;
+        return nullptr;
+    }
+    codeUsed_ += (code_.size() + 15) & ~(size_t) 15;
+
+    return (JitBlockFn) entry;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "MSP430BlockCache.h"
+
+class MSP430;
+
+// Runtime services the translated code calls back into
+struct JitCallbacks
+{
+    // Runs one op through the interpreter, returns false if the block has
+    // been invalidated and execution must leave it.
+    bool (*executeOp)(MSP430 *cpu, Block *block, BlockOp *op);
+    // Accounts for count instructions, taking cycles CPU cycles, executed
+    // natively, and fires the device events due. Returns false if an
+    // interrupt is then ready and execution must leave the block.
+    bool (*account)(MSP430 *cpu, uint32_t count, uint32_t cycles);
+};
+
+// Machine state the translated code accesses directly, as byte offsets
+// from the CPU register file
+struct JitLayout
+{
+    int32_t pageReadData; // bus page tables, DevicesManager::NB_PAGES entries
+    int32_t pageWriteData;
+    int32_t flagsOp; // lazy flags: DECODE_HANDLER_* id, then 32-bit fields
+    int32_t flagsResult;
+    int32_t flagsSrc;
+    int32_t flagsDst;
+    int32_t flagsMask;
+    int32_t flagsPending; // bool
+    int32_t cycles;       // uint64_t CPU time
+    int32_t nextEvent;    // uint64_t due time of the next device event
+};
+
+/**
+ * x86-64 dynamic binary translator for basic blocks.
+ *
+ * Format I MOV, ADD, SUB, CMP, BIT, BIC, BIS, XOR and AND are translated to
+ * host code working directly on the CPU register file (kept in rbx) and,
+ * for memory operands, on the bus page data: the code reads and writes
+ * RAM and flash pages itself, and records the lazy flags like the
+ * specialized handlers do. An access to a page without data (peripherals,
+ * code pages, watched or clean pages) leaves for a slow path that runs the
+ * op through the interpreter. Every other instruction is a call back into
+ * the interpreter for that op, so any block can be translated. Like the
+ * interpreter, translated code fires the device events due and takes the
+ * interrupts they raise after the op reaching their time. The backend is
+ * only available on x86-64 Linux hosts.
+ */
+class MSP430Jit
+{
+public:
+    static constexpr size_t CODE_BUFFER_SIZE = 1024 * 1024;
+    // Executions of a block through the interpreter before translating it
+    static constexpr uint32_t HOT_THRESHOLD = 16;
+
+    MSP430Jit(const JitCallbacks &callbacks, const JitLayout &layout);
+    ~MSP430Jit();
+
+    static bool isSupported();
+
+    // Maps the code buffer if not done yet. Returns false if the host
+    // refuses executable memory, the JIT is then unusable for good.
+    bool prepare();
+    bool hasFailed() const { return failed_; }
+
+    // Returns nullptr when the code buffer is full, reset() must then be
+    // called once no translated code is running anymore. Also returns
+    // nullptr once hasFailed(), the translated code is then not runnable.
+    JitBlockFn compile(Block *block);
+    void reset();
+
+private:
+    // Interpreter fallback of a translated op accessing a page without data
+    struct SlowPath
+    {
+        BlockOp *op;
+        uint32_t pc;
+        uint32_t count;  // native instructions before the op, not accounted
+        uint32_t cycles; // and their cycles
+        std::vector<size_t> fixups; // jumps to the slow path
+        size_t resume;              // code following the op
+    };
+
+    // Exit of a run of translated ops reaching the next device event
+    struct EventStub
+    {
+        uint32_t pc;
+        uint32_t count;  // native instructions run, not accounted
+        uint32_t cycles; // and their cycles
+        std::vector<size_t> fixups;
+        size_t resume;
+    };
+
+    bool canTranslate(const BlockOp &op) const;
+    void emitTranslatedOp(BlockOp &op, uint32_t pc, uint32_t count,
+                          uint32_t cycles);
+    void emitOperandAddress(const InstructionOperand &opd, uint32_t pc,
+                            uint8_t hostReg, uint32_t increment);
+    void emitPageLookup(uint8_t addressReg, uint8_t pointerReg,
+                        int32_t table, uint8_t nbBytes, SlowPath &slow);
+    void emitSlowPath(Block *block, const SlowPath &slow);
+    void emitEventCheck(uint32_t pc, uint32_t count, uint32_t cycles);
+    void emitEventStub(const EventStub &stub);
+    void emitCallOp(Block *block, BlockOp *op);
+    void emitAccount(uint32_t pc, uint32_t count, uint32_t cycles);
+
+    // x86-64 encoding, registers numbered as in ModRM
+    void emitRex(uint8_t flags, uint8_t reg, uint8_t index, uint8_t base);
+    void emitOpcode(uint8_t flags, uint16_t opcode, uint8_t reg,
+                    uint8_t index, uint8_t base);
+    void emitMemOp(uint8_t flags, uint16_t opcode, uint8_t reg, uint8_t base,
+                   uint8_t index, int32_t disp);
+    void emitRegOp(uint8_t flags, uint16_t opcode, uint8_t reg, uint8_t rm);
+    void emitAluImm(uint8_t flags, uint8_t ext, uint8_t rm, uint32_t value);
+    void emitMovImm(uint8_t reg, uint32_t value);
+    void emitJcc(uint8_t condition, std::vector<size_t> &fixups);
+    void emitJump(uint8_t condition, size_t target);
+
+    void emit8(uint8_t byte);
+    void emit32(uint32_t value);
+    void emit64(uint64_t value);
+
+    JitCallbacks callbacks_;
+    JitLayout layout_;
+    uint8_t *codeBuffer_;
+    size_t codeUsed_;
+    bool failed_; // mmap() or mprotect() refused
+    std::vector<uint8_t> code_; // block being translated
+    std::vector<size_t> exitFixups_;
+    std::vector<SlowPath> slowPaths_;
+    std::vector<EventStub> eventStubs_;
+};
@@ -0,0 +1,56 @@
+#include <thread>
+
+#include "MSP430Pacer.h"
+
+MSP430Pacer::MSP430Pacer()
+    : mode_(PACING_REAL_TIME), speed_(1.0), frequency_(DEFAULT_CPU_FREQUENCY),
+      quantumCycles_(0), startCycles_(0), nextCheck_(0)
+{
+    start(0);
+}
+
+void MSP430Pacer::setMode(PACING_MODE mode, double speed)
+{
+    mode_ = mode;
+    speed_ = ((mode == PACING_SCALED) && (speed > 0)) ? speed : 1.0;
+    start(startCycles_);
+}
+
+void MSP430Pacer::setCpuFrequency(uint64_t frequency)
+{
+    frequency_ = frequency;
+    start(startCycles_);
+}
+
+void MSP430Pacer::start(uint64_t cycles)
+{
+    quantumCycles_ = (uint64_t) (frequency_ * speed_ * QUANTUM_US / 1e6);
+    if (quantumCycles_ == 0)
+    {
+        quantumCycles_ = 1;
+    }
+    startCycles_ = cycles;
+    startTime_ = Clock::now();
+    nextCheck_ = cycles + quantumCycles_;
+}
+
+void MSP430Pacer::sync(uint64_t cycles)
+{
+    uint64_t simulatedUs =
+        (uint64_t) ((cycles - startCycles_) * 1e6 / (frequency_ * speed_));
+    uint64_t hostUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                          Clock::now() - startTime_)
+                          .count();
+
+    nextCheck_ = cycles + quantumCycles_;
+
+    if (simulatedUs > hostUs + QUANTUM_US)
+    {
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(simulatedUs - hostUs));
+    }
+    else if (hostUs > simulatedUs + MAX_LAG_US)
+    {
+        start(cycles);
+    }
+}
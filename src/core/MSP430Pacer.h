@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+
+// How fast simulated time runs compared to the host clock
+enum PACING_MODE
+{
+    PACING_MAX_SPEED, // unthrottled
+    PACING_REAL_TIME, // one simulated second per host second
+    PACING_SCALED,    // real time multiplied by a speed factor
+};
+
+/**
+ * Paces execution against the host monotonic clock.
+ *
+ * The host clock is only looked at every QUANTUM_US of simulated time, and
+ * the emulator only sleeps once it is more than a quantum ahead, so pacing
+ * costs a few clock reads and sleeps per simulated second whatever the
+ * instruction rate. When the host can not keep up for more than MAX_LAG_US,
+ * the reference point is moved instead of trying to catch up with a burst.
+ */
+class MSP430Pacer
+{
+public:
+    static constexpr uint64_t DEFAULT_CPU_FREQUENCY = 1000000; // Hz
+    static constexpr uint64_t QUANTUM_US = 10000;
+    static constexpr uint64_t MAX_LAG_US = 100000;
+
+    MSP430Pacer();
+
+    // speed is only used by PACING_SCALED, 2.0 runs twice as fast as the
+    // device would
+    void setMode(PACING_MODE mode, double speed = 1.0);
+    PACING_MODE getMode() const { return mode_; }
+    void setCpuFrequency(uint64_t frequency);
+
+    // Starts pacing from the given cycle count
+    void start(uint64_t cycles);
+    // Sleeps if simulated time at cycles is ahead of the host clock
+    void pace(uint64_t cycles)
+    {
+        if ((mode_ != PACING_MAX_SPEED) && (cycles >= nextCheck_))
+        {
+            sync(cycles);
+        }
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void sync(uint64_t cycles);
+
+    PACING_MODE mode_;
+    double speed_;
+    uint64_t frequency_;
+    uint64_t quantumCycles_; // simulated cycles per host quantum
+    uint64_t startCycles_;
+    Clock::time_point startTime_;
+    uint64_t nextCheck_;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Appends the state of the machine to an in-memory buffer.
+ *
+ * Values are stored in host byte order: snapshots are meant to be restored
+ * by the same build, on the same host. Clearing the buffer between two
+ * snapshots keeps its capacity, so that taking one does not allocate.
+ */
+class SnapshotWriter
+{
+public:
+    explicit SnapshotWriter(std::vector<uint8_t> &buffer) : buffer_(buffer) {}
+
+    void write(const void *data, size_t size)
+    {
+        size_t offset = buffer_.size();
+
+        buffer_.resize(offset + size);
+        memcpy(buffer_.data() + offset, data, size);
+    }
+
+    template <typename T> void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "only plain values can be written");
+        write(&value, sizeof(value));
+    }
+
+    void writeString(const std::string &str)
+    {
+        write((uint32_t) str.size());
+        write(str.data(), str.size());
+    }
+
+private:
+    std::vector<uint8_t> &buffer_;
+};
+
+/**
+ * Reads back a state written by SnapshotWriter. Reads past the end of the
+ * buffer fail and leave the destination untouched.
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader(const uint8_t *data, size_t size)
+        : data_(data), size_(size), offset_(0)
+    {
+    }
+
+    bool read(void *data, size_t size)
+    {
+        const uint8_t *source = peek(size);
+
+        if (source == nullptr)
+        {
+            return false;
+        }
+        memcpy(data, source, size);
+        offset_ += size;
+        return true;
+    }
+
+    template <typename T> bool read(T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "only plain values can be read");
+        return read(&value, sizeof(value));
+    }
+
+    bool readString(std::string &str)
+    {
+        uint32_t size;
+
+        if (!read(size) || (peek(size) == nullptr))
+        {
+            return false;
+        }
+        str.assign((const char *) data_ + offset_, size);
+        offset_ += size;
+        return true;
+    }
+
+    bool skip(size_t size)
+    {
+        if (peek(size) == nullptr)
+        {
+            return false;
+        }
+        offset_ += size;
+        return true;
+    }
+
+    // Next size bytes, without consuming them; nullptr if not available
+    const uint8_t *peek(size_t size) const
+    {
+        return (size <= size_ - offset_) ? data_ + offset_ : nullptr;
+    }
+
+    bool atEnd() const { return offset_ == size_; }
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+    size_t offset_;
+};
@@ -0,0 +1,100 @@
+#include <mutex>
+#include <stdarg.h>
+
+#include "MSP430Trace.h"
+
+static const char *const categoryNames[NB_TRACE_CATEGORIES] = {
+    "cpu", "decode", "bus", "port", "watchdog"};
+
+// Shared by every thread tracing, guarded by traceMutex
+static std::mutex traceMutex;
+static char buffer[MSP430Trace::BUFFER_SIZE];
+static size_t bufferUsed = 0;
+static FILE *traceOutput = nullptr;
+
+std::atomic<uint32_t> MSP430Trace::categories_{
+    (1u << NB_TRACE_CATEGORIES) - 1};
+
+// Writes the buffer to the output, traceMutex must be held
+static void flushBuffer()
+{
+    FILE *output = traceOutput ? traceOutput : stderr;
+
+    if (bufferUsed == 0)
+    {
+        return;
+    }
+    fwrite(buffer, 1, bufferUsed, output);
+    fflush(output);
+    bufferUsed = 0;
+}
+
+// Writes what is left in the buffer when the program exits
+static struct TraceExitFlush
+{
+    ~TraceExitFlush() { MSP430Trace::flush(); }
+} traceExitFlush;
+
+void MSP430Trace::setEnabled(enum TRACE_CATEGORY category, bool enabled)
+{
+    if (enabled)
+    {
+        categories_ |= (1u << category);
+    }
+    else
+    {
+        categories_ &= ~(1u << category);
+    }
+}
+
+void MSP430Trace::setOutput(FILE *output)
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    flushBuffer();
+    traceOutput = output;
+}
+
+void MSP430Trace::write(enum TRACE_CATEGORY category, const char *format, ...)
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        size_t left = BUFFER_SIZE - bufferUsed;
+        int len = snprintf(buffer + bufferUsed, left, "[%s] ",
+                           categoryNames[category]);
+        va_list args;
+
+        if ((len >= 0) && ((size_t) len < left))
+        {
+            va_start(args, format);
+            len += vsnprintf(buffer + bufferUsed + len, left - len, format,
+                             args);
+            va_end(args);
+        }
+
+        if ((len >= 0) && ((size_t) len < left))
+        {
+            bufferUsed += len;
+            return;
+        }
+
+        // The message does not fit: make room and retry once, a message
+        // larger than the whole buffer is truncated
+        if (bufferUsed == 0)
+        {
+            bufferUsed = BUFFER_SIZE - 1;
+            break;
+        }
+        flushBuffer();
+    }
+    flushBuffer();
+}
+
+void MSP430Trace::flush()
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    flushBuffer();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Trace levels, a message is compiled in if its level is lower or equal to
+// MSP430_TRACE_LEVEL
+#define TRACE_LEVEL_NONE 0
+#define TRACE_LEVEL_ERROR 1
+#define TRACE_LEVEL_INFO 2
+#define TRACE_LEVEL_DEBUG 3
+
+#ifndef MSP430_TRACE_LEVEL
+#define MSP430_TRACE_LEVEL TRACE_LEVEL_NONE
+#endif
+
+enum TRACE_CATEGORY
+{
+    TRACE_CPU = 0,
+    TRACE_DECODE,
+    TRACE_BUS,
+    TRACE_PORT,
+    TRACE_WATCHDOG,
+    NB_TRACE_CATEGORIES
+};
+
+/**
+ * Buffered trace sink.
+ *
+ * Messages are formatted into a memory buffer which is written to the output
+ * file only when it is full, on flush() or at exit, so tracing does not make
+ * the emulator I/O bound. Categories can be muted at runtime; levels are
+ * selected at compile time through MSP430_TRACE_LEVEL. Machines running on
+ * several threads share the sink, messages are never interleaved.
+ */
+class MSP430Trace
+{
+public:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    static constexpr bool isCompiled(int level)
+    {
+        return level <= MSP430_TRACE_LEVEL;
+    }
+
+    static bool isEnabled(enum TRACE_CATEGORY category)
+    {
+        return (categories_ & (1u << category)) != 0;
+    }
+    static void setEnabled(enum TRACE_CATEGORY category, bool enabled);
+
+    // Flushes pending messages, then sends the next ones to output
+    // (stderr by default)
+    static void setOutput(FILE *output);
+    static void write(enum TRACE_CATEGORY category, const char *format, ...)
+        __attribute__((format(printf, 2, 3)));
+    static void flush();
+
+private:
+    static std::atomic<uint32_t> categories_;
+};
+
+/*
+ * Traces a printf like message. Messages above MSP430_TRACE_LEVEL are
+ * discarded at compile time, their arguments are never evaluated.
+ */
+#define MSP430_TRACE(level, category, ...)                                     \
+    do                                                                         \
+    {                                                                          \
+        if constexpr (MSP430Trace::isCompiled(level))                          \
+        {                                                                      \
+            if (MSP430Trace::isEnabled(category))                              \
+            {                                                                  \
+                MSP430Trace::write(category, __VA_ARGS__);                     \
+            }                                                                  \
+        }                                                                      \
+    } while (0)
+
+#define TRACE_ERROR(category, ...)                                             \
+    MSP430_TRACE(TRACE_LEVEL_ERROR, category, __VA_ARGS__)
+#define TRACE_INFO(category, ...)                                              \
+    MSP430_TRACE(TRACE_LEVEL_INFO, category, __VA_ARGS__)
+#define TRACE_DEBUG(category, ...)                                             \
+    MSP430_TRACE(TRACE_LEVEL_DEBUG, category, __VA_ARGS__)
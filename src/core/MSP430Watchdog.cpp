@@ -1,6 +1,6 @@
 #include <assert.h>
-#include <iostream>
 
+#include "MSP430Trace.h"
 #include "MSP430Watchdog.h"
 
 MSP430Watchdog::MSP430Watchdog() : Device(0x120, 0x121, "wdog") { init(); }
@@ -21,18 +21,12 @@ void MSP430Watchdog::destroy()
     // Cleanup if any is required when destroying the device
 }
 
-void MSP430Watchdog::update()
-{
-    // Update the device state, if required
-}
-
 uint16_t MSP430Watchdog::readWord(uint32_t address)
 {
     // Address check is needed to ensure we're reading the correct register
     if (address == 0x0120) // The address of WDTCTL based on your map file
     {
-        std::cout << "read from wdog register" << std::hex << WDTCTL
-                  << std::endl;
+        TRACE_DEBUG(TRACE_WATCHDOG, "read from wdog register %X\n", WDTCTL);
         return WDTCTL;
     }
     // If the address doesn't match any known register, trigger an error
@@ -42,7 +36,7 @@ uint16_t MSP430Watchdog::readWord(uint32_t address)
 
 void MSP430Watchdog::writeWord(uint32_t address, uint16_t value)
 {
-    std::cout << "write in wdog register" << std::endl;
+    TRACE_DEBUG(TRACE_WATCHDOG, "write in wdog register %X\n", value);
 
     // Address check is needed to ensure we're writing to the correct register
     if (address == 0x0120)
@@ -13,12 +13,18 @@ public:
     // Override functions from Device interface
     void init() override;
     void destroy() override;
-    void update() override;
     uint16_t readWord(uint32_t address) override;
     void writeWord(uint32_t address, uint16_t value) override;
 
     void writeByte(uint32_t address, uint8_t value) override {}
 
+    void saveState(SnapshotWriter &out) const override { out.write(WDTCTL); }
+    bool loadState(SnapshotReader &in) override { return in.read(WDTCTL); }
+    bool checkState(SnapshotReader &in) const override
+    {
+        return in.skip(sizeof(WDTCTL));
+    }
+
 private:
     uint16_t WDTCTL; // Watchdog Timer Control Register
 };
@@ -1,10 +1,27 @@
+#include <algorithm>
 #include <assert.h>
+#include <random>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "Memory.h"
 
-Memory::Memory() : Device(0, MSP430F2618_MAX_MEMORY_ADDRESS, "mem") { init(); }
+// Kinds of memory states in a snapshot
+static constexpr uint8_t STATE_FULL = 0;
+static constexpr uint8_t STATE_DIRTY_PAGES = 1;
+
+Memory::Memory()
+    : Device(0, MSP430F2618_MAX_MEMORY_ADDRESS, "mem"),
+      checkpointId_(NO_CHECKPOINT), dirty_(NB_PAGES, 1),
+      originals_(NB_PAGES), pageMarks_(NB_PAGES, 0), pageListener_(nullptr)
+{
+    for (uint32_t page = 0; page < NB_PAGES; page++)
+    {
+        dirtyPages_.push_back(page);
+    }
+    init();
+}
 
 void Memory::init()
 {
@@ -13,11 +30,6 @@ void Memory::init()
 
 void Memory::destroy() {}
 
-void Memory::update()
-{
-    // No update action required for memory
-}
-
 uint8_t Memory::readByte(uint32_t address)
 {
     assert(address < memory.size());
@@ -46,12 +58,14 @@ uint32_t Memory::readDWord(uint32_t address)
 void Memory::writeByte(uint32_t address, uint8_t value)
 {
     assert(address < memory.size());
+    touch(address, 1);
     memory[address] = value;
 }
 
 void Memory::writeWord(uint32_t address, uint16_t value)
 {
     assert(address + 1 < memory.size());
+    touch(address, 2);
     memory[address] = value & 0xFF;
     memory[address + 1] = (value >> 8) & 0xFF;
 }
@@ -59,12 +73,261 @@ void Memory::writeWord(uint32_t address, uint16_t value)
 void Memory::writeDWord(uint32_t address, uint32_t value)
 {
     assert(address + 3 < memory.size());
+    touch(address, 4);
     for (uint32_t i = 0; i < 4; i++)
     {
         memory[address + i] = (value >> (8 * i)) & 0xFF;
     }
 }
 
+/**
+ * Makes the current content the reference of the dirty page tracking:
+ * every page becomes clean. Checkpoints get a random id, so that dirty
+ * pages states are only restored on the checkpoint they were taken from.
+ */
+void Memory::checkpoint()
+{
+    // One generator per thread, machines may checkpoint concurrently
+    thread_local std::mt19937_64 generator(std::random_device{}());
+
+    do
+    {
+        checkpointId_ = generator();
+    } while (checkpointId_ == NO_CHECKPOINT);
+
+    for (uint32_t page : dirtyPages_)
+    {
+        dirty_[page] = 0;
+        notifyPage(page, false);
+    }
+    dirtyPages_.clear();
+}
+
+// Saves the content of a clean page before it is first written
+void Memory::markDirty(uint32_t page)
+{
+    if (!originals_[page])
+    {
+        originals_[page] = std::make_unique<Page>();
+    }
+    memcpy(originals_[page]->data(), memory.data() + (page << PAGE_SHIFT),
+           pageBytes(page));
+
+    dirty_[page] = 1;
+    dirtyPages_.push_back(page);
+    notifyPage(page, false);
+}
+
+// Size of a page, the last one being shorter
+uint32_t Memory::pageBytes(uint32_t page) const
+{
+    return std::min<size_t>(PAGE_SIZE, memory.size() - (page << PAGE_SHIFT));
+}
+
+// Rewrites a page, returns true if its content changed
+bool Memory::restorePage(uint32_t page, const uint8_t *content)
+{
+    uint8_t *data = memory.data() + (page << PAGE_SHIFT);
+    uint32_t size = pageBytes(page);
+
+    if (memcmp(data, content, size) == 0)
+    {
+        return false;
+    }
+    memcpy(data, content, size);
+    return true;
+}
+
+void Memory::notifyPage(uint32_t page, bool contentChanged)
+{
+    if (pageListener_ != nullptr)
+    {
+        pageListener_->onPageChanged(page, contentChanged);
+    }
+}
+
+void Memory::saveState(SnapshotWriter &out) const
+{
+    out.write(checkpointId_);
+    out.write(STATE_FULL);
+    out.write(memory.data(), memory.size());
+}
+
+void Memory::saveDirtyState(SnapshotWriter &out) const
+{
+    out.write(checkpointId_);
+    out.write(STATE_DIRTY_PAGES);
+    out.write((uint32_t) dirtyPages_.size());
+    for (uint32_t page : dirtyPages_)
+    {
+        out.write(page);
+        out.write(memory.data() + (page << PAGE_SHIFT), pageBytes(page));
+    }
+}
+
+bool Memory::loadState(SnapshotReader &in)
+{
+    uint64_t id;
+    uint8_t kind;
+
+    if (!in.read(id) || !in.read(kind))
+    {
+        return false;
+    }
+
+    switch (kind)
+    {
+    case STATE_FULL:
+        return loadFullState(in, id);
+    case STATE_DIRTY_PAGES:
+        return loadDirtyState(in, id);
+    default:
+        return false;
+    }
+}
+
+bool Memory::checkState(SnapshotReader &in) const
+{
+    uint64_t id;
+    uint8_t kind;
+    uint32_t count;
+    uint32_t page;
+
+    if (!in.read(id) || !in.read(kind))
+    {
+        return false;
+    }
+
+    switch (kind)
+    {
+    case STATE_FULL:
+        return in.skip(memory.size());
+    case STATE_DIRTY_PAGES:
+        if ((id == NO_CHECKPOINT) || (id != checkpointId_) || !in.read(count))
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (!in.read(page) || (page >= NB_PAGES) ||
+                !in.skip(pageBytes(page)))
+            {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Loads a memory image. Restoring the image of the current checkpoint only
+ * rewrites the dirty pages; any other image becomes the new checkpoint.
+ */
+bool Memory::loadFullState(SnapshotReader &in, uint64_t id)
+{
+    const uint8_t *image = in.peek(memory.size());
+
+    if (image == nullptr)
+    {
+        return false;
+    }
+
+    if ((id != NO_CHECKPOINT) && (id == checkpointId_))
+    {
+        for (uint32_t page : dirtyPages_)
+        {
+            dirty_[page] = 0;
+            notifyPage(page, restorePage(page, image + (page << PAGE_SHIFT)));
+        }
+    }
+    else
+    {
+        for (uint32_t page = 0; page < NB_PAGES; page++)
+        {
+            bool wasDirty = dirty_[page];
+            bool changed = restorePage(page, image + (page << PAGE_SHIFT));
+
+            dirty_[page] = (id == NO_CHECKPOINT);
+            if (changed || (wasDirty != dirty_[page]))
+            {
+                notifyPage(page, changed);
+            }
+        }
+        checkpointId_ = id;
+    }
+
+    dirtyPages_.clear();
+    if (id == NO_CHECKPOINT)
+    {
+        for (uint32_t page = 0; page < NB_PAGES; page++)
+        {
+            dirtyPages_.push_back(page);
+        }
+    }
+    return in.skip(memory.size());
+}
+
+/**
+ * Loads the dirty pages of a state taken on the current checkpoint. The
+ * pages dirty now but not in the state get back their checkpoint content.
+ */
+bool Memory::loadDirtyState(SnapshotReader &in, uint64_t id)
+{
+    SnapshotReader check = in;
+    uint32_t count;
+    uint32_t page;
+    size_t kept = 0;
+
+    if ((id == NO_CHECKPOINT) || (id != checkpointId_) || !check.read(count))
+    {
+        return false;
+    }
+
+    // Validate the pages, and mark the ones held by the state
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!check.read(page) || (page >= NB_PAGES) ||
+            !check.skip(pageBytes(page)))
+        {
+            std::fill(pageMarks_.begin(), pageMarks_.end(), 0);
+            return false;
+        }
+        pageMarks_[page] = 1;
+    }
+
+    for (uint32_t dirtyPage : dirtyPages_)
+    {
+        if (pageMarks_[dirtyPage])
+        {
+            dirtyPages_[kept++] = dirtyPage;
+            continue;
+        }
+        dirty_[dirtyPage] = 0;
+        notifyPage(dirtyPage,
+                   restorePage(dirtyPage, originals_[dirtyPage]->data()));
+    }
+    dirtyPages_.resize(kept);
+
+    in.read(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        in.read(page);
+        pageMarks_[page] = 0;
+        if (!dirty_[page])
+        {
+            markDirty(page);
+        }
+        if (restorePage(page, in.peek(pageBytes(page))))
+        {
+            notifyPage(page, true);
+        }
+        in.skip(pageBytes(page));
+    }
+    return true;
+}
+
 void Memory::dump(uint32_t address, uint32_t len)
 {
     for (size_t line = 0; line < len / 16; line++)
@@ -1,22 +1,49 @@
 #pragma once
 
 #include <array>
+#include <memory>
+#include <vector>
 
 #include "Device.h"
 
 // or the actual max address based on the datasheet
 static constexpr uint32_t MSP430F2618_MAX_MEMORY_ADDRESS = 0x1FFFFF;
 
+// Notified when a memory page becomes dirty, or is rewritten by a restore
+class MemoryPageListener
+{
+public:
+    virtual ~MemoryPageListener() = default;
+    virtual void onPageChanged(uint32_t page, bool contentChanged) = 0;
+};
+
+/**
+ * Memory of the microcontroller.
+ *
+ * Pages written since the last checkpoint are tracked as dirty, keeping a
+ * copy of their content at the checkpoint (copy on write). Snapshots can
+ * then store only the dirty pages, and restores only rewrite them. Before
+ * the first checkpoint, every page is dirty.
+ *
+ * Writes done through data() are not tracked: the bus only writes there
+ * to pages already dirty.
+ */
 class Memory : public Device
 {
 public:
+    // Dirty tracking granularity, the page size of the bus page table
+    static constexpr uint32_t PAGE_SHIFT = 9;
+    static constexpr uint32_t PAGE_SIZE = 1 << PAGE_SHIFT;
+    static constexpr uint32_t NB_PAGES =
+        (MSP430F2618_MAX_MEMORY_ADDRESS + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
     Memory();
 
     // Implémentations des méthodes de Device
     void init() override;
     void destroy() override;
-    void update() override;
 
+    bool hasByteAccess() const override { return true; }
     uint8_t readByte(uint32_t address) override;
     uint16_t readWord(uint32_t address) override;
     uint32_t readDWord(uint32_t address) override;
@@ -27,6 +54,56 @@ public:
 
     void dump(uint32_t address, uint32_t len) override;
 
+    // Full state: the checkpoint id and the raw memory image
+    void saveState(SnapshotWriter &out) const override;
+    // Either state; a dirty pages state only loads on its own checkpoint
+    bool loadState(SnapshotReader &in) override;
+    bool checkState(SnapshotReader &in) const override;
+    // Incremental state: the pages written since the checkpoint
+    void saveDirtyState(SnapshotWriter &out) const;
+
+    void checkpoint();
+    bool hasCheckpoint() const { return checkpointId_ != NO_CHECKPOINT; }
+    bool isDirty(uint32_t page) const { return dirty_[page]; }
+    size_t getNbDirtyPages() const { return dirtyPages_.size(); }
+    void setPageListener(MemoryPageListener *listener)
+    {
+        pageListener_ = listener;
+    }
+
+    // Raw backing storage, used by the bus fast path
+    uint8_t *data() { return memory.data(); }
+    size_t size() const { return memory.size(); }
+
 private:
+    static constexpr uint64_t NO_CHECKPOINT = 0;
+    typedef std::array<uint8_t, PAGE_SIZE> Page;
+
+    void touch(uint32_t address, uint32_t nbBytes)
+    {
+        for (uint32_t page = address >> PAGE_SHIFT;
+             page <= (address + nbBytes - 1) >> PAGE_SHIFT; page++)
+        {
+            if (!dirty_[page])
+            {
+                markDirty(page);
+            }
+        }
+    }
+    void markDirty(uint32_t page);
+    uint32_t pageBytes(uint32_t page) const;
+    bool restorePage(uint32_t page, const uint8_t *content);
+    void notifyPage(uint32_t page, bool contentChanged);
+    bool loadFullState(SnapshotReader &in, uint64_t id);
+    bool loadDirtyState(SnapshotReader &in, uint64_t id);
+
     std::array<uint8_t, MSP430F2618_MAX_MEMORY_ADDRESS> memory;
+
+    uint64_t checkpointId_;
+    std::vector<uint8_t> dirty_;
+    std::vector<uint32_t> dirtyPages_;
+    // Content at the checkpoint of the dirty pages, allocated on first use
+    std::vector<std::unique_ptr<Page>> originals_;
+    std::vector<uint8_t> pageMarks_; // scratch of loadDirtyState()
+    MemoryPageListener *pageListener_;
 };
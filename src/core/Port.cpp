@@ -1,6 +1,6 @@
 #include <assert.h>
-#include <iostream>
 
+#include "MSP430Trace.h"
 #include "Port.h"
 
 void Port::init()
@@ -14,15 +14,45 @@ void Port::destroy()
     // Cleanup if any is required when destroying the device
 }
 
-void Port::update()
+namespace
 {
-    // Update the device state, if required
+
+// Peripheral made of two callbacks
+class CallbackPeripheral : public Peripheral
+{
+public:
+    CallbackPeripheral(RxCBType rxCb, TxCBType txCb)
+        : rxCb_(std::move(rxCb)), txCb_(std::move(txCb))
+    {
+    }
+
+    void txCb(uint8_t value) override { txCb_(value); }
+    uint8_t rxCb() override { return rxCb_(); }
+
+private:
+    RxCBType rxCb_;
+    TxCBType txCb_;
+};
+
+} // namespace
+
+void Port::attachPeripheral(Peripheral *peripheral)
+{
+    peripherals_.push_back(peripheral);
 }
 
 void Port::registerPeripheral(RxCBType rxCb, TxCBType txCb)
 {
-    rxCbs_.push_back(rxCb);
-    txCbs_.push_back(txCb);
+    ownedPeripherals_.push_back(
+        std::make_unique<CallbackPeripheral>(std::move(rxCb), std::move(txCb)));
+    attachPeripheral(ownedPeripherals_.back().get());
+}
+
+void Port::unregisterPeripherals()
+{
+    nbPinChanges_ = 0;
+    peripherals_.clear();
+    ownedPeripherals_.clear();
 }
 
 std::vector<AddressRange>
@@ -39,25 +69,81 @@ Port::setAddresses(const std::initializer_list<uint32_t> &addresses)
     return ranges;
 }
 
-void Port::invokeTxCbs(uint8_t value)
+/**
+ * Buffers an output change. Changes are delivered in batches, so that
+ * bit-banged protocols cost one call per peripheral every MAX_PIN_CHANGES
+ * changes rather than one per write.
+ */
+void Port::queuePinChange(uint8_t value)
+{
+    if (peripherals_.empty())
+    {
+        return;
+    }
+    if (nbPinChanges_ == MAX_PIN_CHANGES)
+    {
+        deliverPinChanges();
+    }
+    pinChanges_[nbPinChanges_++] = {scheduler_ ? scheduler_->now() : 0,
+                                    value};
+}
+
+void Port::deliverPinChanges()
+{
+    size_t count = nbPinChanges_;
+
+    // Peripherals may write to the port from their callback
+    nbPinChanges_ = 0;
+    for (Peripheral *peripheral : peripherals_)
+    {
+        peripheral->onPinChanges(pinChanges_.data(), count);
+    }
+}
+
+// Inputs driven by the attached peripherals, ORed together
+uint8_t Port::invokeRxCbs()
 {
-    for (auto cb : txCbs_)
+    uint8_t value = 0;
+
+    for (Peripheral *peripheral : peripherals_)
     {
-        cb(value);
+        value |= peripheral->rxCb();
     }
+    return value;
+}
+
+// The port requests its interrupt while an enabled flag is set
+void Port::updateInterrupt()
+{
+    if (interrupts_ && (interruptLine_ != InterruptController::NO_LINE))
+    {
+        interrupts_->setLevel(interruptLine_, (ifg_ & ie_) != 0);
+    }
+}
+
+// Pins driven by the peripherals, recorded or replayed by the input log
+uint8_t Port::sampleInputs()
+{
+    if (inputLog_ == nullptr)
+    {
+        return invokeRxCbs();
+    }
+    return inputLog_->sample(inputChannel_, [this] { return invokeRxCbs(); });
 }
 
 uint8_t Port::readByte(uint32_t address)
 {
-    std::cout << "read " << name_ << " = " << std::hex << " @addr:" << address
-              << std::endl;
+    TRACE_DEBUG(TRACE_PORT, "read %s @addr:%X\n", name_.c_str(), address);
 
     // Address check is needed to ensure we're reading the correct register
     if (address == addrIn_) // The address of WDTCTL based on your map file
     {
-        std::cout << "read from " << name_ << ": " << std::hex << value_ + 0
-                  << std::endl;
-        return (value_ & ren_ & (!dir_));
+        // Peripherals answer to the outputs written so far
+        flushPinChanges();
+        uint8_t pins = value_ | sampleInputs();
+
+        TRACE_DEBUG(TRACE_PORT, "read from %s: %X\n", name_.c_str(), pins);
+        return (pins & ren_ & ~dir_);
     }
     else if (address == addrOut_)
     {
@@ -88,9 +174,8 @@ uint8_t Port::readByte(uint32_t address)
         return (ie_);
     }
 
-    std::cout << "read ooops " << name_ << " = " << std::hex
-              << " @addr:" << address << " vs " << std::hex << addrOut_
-              << std::endl;
+    TRACE_ERROR(TRACE_PORT, "read ooops %s @addr:%X vs %X\n", name_.c_str(),
+                address, addrOut_);
 
     // If the address doesn't match any known register, trigger an error
     assert(false);
@@ -99,12 +184,14 @@ uint8_t Port::readByte(uint32_t address)
 
 void Port::writeByte(uint32_t address, uint8_t value)
 {
-    std::cout << "write " << name_ << " = " << std::hex << value + 0
-              << " @addr:" << address << std::endl;
+    TRACE_DEBUG(TRACE_PORT, "write %s = %X @addr:%X\n", name_.c_str(), value,
+                address);
 
     // Address check is needed to ensure we're writing to the correct register
     if (address == addrOut_)
     {
+        uint8_t previous = out_;
+
         // hack
         value_ = (value & ren_ & dir_);
         if (addrOut_ == 0x21)
@@ -121,7 +208,10 @@ void Port::writeByte(uint32_t address, uint8_t value)
             value_ = value_ | 0x1;
         out_ = value_;
 
-        invokeTxCbs(value_);
+        if (out_ != previous)
+        {
+            queuePinChange(out_);
+        }
     }
     else if (address == addrRen_)
     {
@@ -137,20 +227,22 @@ void Port::writeByte(uint32_t address, uint8_t value)
     }
     else if (address == addrIfg_)
     {
-        /* FIXME */
+        // Pin edges are not detected yet, flags are only set by software
+        ifg_ = value & 0xFF;
+        updateInterrupt();
     }
     else if (address == addrIes_)
     {
-        /* FIXME */
+        ies_ = value & 0xFF;
     }
     else if (address == addrIe_)
     {
-        /* FIXME */
+        ie_ = value & 0xFF;
+        updateInterrupt();
     }
     else if (address == addrIn_)
     {
-        std::cout << "***** FW error ? trying to write into input port"
-                  << std::endl;
+        TRACE_ERROR(TRACE_PORT, "FW error ? trying to write into input port\n");
     }
     else
     {
@@ -159,6 +251,42 @@ void Port::writeByte(uint32_t address, uint8_t value)
     }
 }
 
+void Port::saveState(SnapshotWriter &out) const
+{
+    uint8_t state[] = {value_, ren_, dir_, sel_, out_, ies_, ifg_, ie_};
+
+    out.write(state);
+}
+
+bool Port::loadState(SnapshotReader &in)
+{
+    uint8_t state[8];
+
+    if (!in.read(state))
+    {
+        return false;
+    }
+
+    value_ = state[0];
+    ren_ = state[1];
+    dir_ = state[2];
+    sel_ = state[3];
+    out_ = state[4];
+    ies_ = state[5];
+    ifg_ = state[6];
+    ie_ = state[7];
+    // Changes made after the snapshot are not delivered
+    nbPinChanges_ = 0;
+    return true;
+}
+
+bool Port::checkState(SnapshotReader &in) const
+{
+    uint8_t state[8];
+
+    return in.read(state);
+}
+
 uint16_t Port::readWord(uint32_t address)
 {
     assert(false);
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <array>
 #include <functional>
+#include <memory>
 #include <stdint.h>
 
 #include "Device.h"
+#include "InputLog.h"
+#include "Peripheral.h"
 
 typedef std::function<void(uint8_t value)> TxCBType;
 typedef std::function<uint8_t()> RxCBType;
@@ -15,7 +19,8 @@ public:
          uint32_t dir, uint32_t sel, uint32_t ifg = 0, uint32_t ies = 0,
          uint32_t ie = 0)
         : Device(setAddresses({ren, in, out, dir, sel, ifg, ies, ie}), name),
-          value_(0), ren_(0), dir_(0), sel_(0), ies_(0), ifg_(0), ie_(0),
+          value_(0), ren_(0), dir_(0), sel_(0), out_(0), ies_(0), ifg_(0),
+          ie_(0),
           addrRen_(ren), addrIn_(in), addrOut_(out), addrDir_(dir),
           addrSel_(sel), addrIfg_(ifg), addrIes_(ies), addrIe_(ie)
     {
@@ -26,22 +31,59 @@ public:
     // Override functions from Device interface
     void init() override;
     void destroy() override;
-    void update() override;
 
+    // Peripherals are called directly, they must outlive their connection.
+    // Reading the IN register ORs the inputs of every peripheral into the
+    // pins the port drives itself.
+    void attachPeripheral(Peripheral *peripheral);
+    // Connects callbacks, through a peripheral owned by the port
     void registerPeripheral(RxCBType rxCb, TxCBType txCb);
+    void unregisterPeripherals();
+    // Delivers the buffered output changes to the peripherals
+    void flushPinChanges()
+    {
+        if (nbPinChanges_ != 0)
+        {
+            deliverPinChanges();
+        }
+    }
+    // Peripheral inputs are sampled through log, on the given channel
+    void attachInputLog(InputLog *log, uint8_t channel)
+    {
+        inputLog_ = log;
+        inputChannel_ = channel;
+    }
+
+    // Interrupt line of the port flags, NO_LINE if the port has none
+    void setInterruptLine(uint8_t line) { interruptLine_ = line; }
 
+    bool hasByteAccess() const override { return true; }
     uint16_t readWord(uint32_t address) override;
     uint8_t readByte(uint32_t address) override;
     void writeWord(uint32_t address, uint16_t value) override;
     void writeByte(uint32_t address, uint8_t value) override;
 
+    void saveState(SnapshotWriter &out) const override;
+    bool loadState(SnapshotReader &in) override;
+    bool checkState(SnapshotReader &in) const override;
+
 protected:
-    std::vector<RxCBType> rxCbs_;
-    std::vector<TxCBType> txCbs_;
+    // Output changes buffered before being delivered at once
+    static constexpr size_t MAX_PIN_CHANGES = 64;
+
+    std::vector<Peripheral *> peripherals_;
+    std::vector<std::unique_ptr<Peripheral>> ownedPeripherals_;
+    std::array<PinChange, MAX_PIN_CHANGES> pinChanges_;
+    size_t nbPinChanges_ = 0;
+
     std::vector<AddressRange>
 
     setAddresses(const std::initializer_list<uint32_t> &addresses);
-    void invokeTxCbs(uint8_t value);
+    void queuePinChange(uint8_t value);
+    void deliverPinChanges();
+    uint8_t invokeRxCbs();
+    uint8_t sampleInputs();
+    void updateInterrupt();
 
     uint8_t value_;
     uint8_t ren_;
@@ -60,4 +102,8 @@ protected:
     uint32_t addrIfg_;
     uint32_t addrIes_;
     uint32_t addrIe_;
+
+    InputLog *inputLog_ = nullptr;
+    uint8_t inputChannel_ = 0;
+    uint8_t interruptLine_ = InterruptController::NO_LINE;
 };
@@ -13,4 +13,5 @@ Port1::Port1()
     : Port("Port1", P1REN, P1IN, P1OUT, P1DIR, P1SEL, P1IFG, P1IES, P1IE)
 {
     value_ = 0x91;
+    setInterruptLine(InterruptController::LINE_PORT1);
 }
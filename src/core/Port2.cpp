@@ -13,4 +13,5 @@ Port2::Port2()
     : Port("Port2", P2REN, P2IN, P2OUT, P2DIR, P2SEL, P2IFG, P2IES, P2IE)
 {
     value_ = 0xef;
+    setInterruptLine(InterruptController::LINE_PORT2);
 }
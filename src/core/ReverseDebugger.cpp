@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <assert.h>
+
+#include "ReverseDebugger.h"
+
+ReverseDebugger::ReverseDebugger(MSP430 &cpu, uint64_t interval)
+    : cpu_(cpu), interval_(interval), horizon_(0)
+{
+}
+
+/**
+ * Takes the first checkpoint, a full snapshot, and starts recording the
+ * inputs. Returns false if the machine state cannot be saved.
+ */
+bool ReverseDebugger::start()
+{
+    checkpoints_.clear();
+    if (!takeCheckpoint(true))
+    {
+        return false;
+    }
+
+    horizon_ = cpu_.getCycles();
+    cpu_.getDevicesManager().getInputLog().startRecording();
+    return true;
+}
+
+bool ReverseDebugger::takeCheckpoint(bool full)
+{
+    checkpoints_.push_back({getPosition(), cpu_.getCycles(), {}});
+    if (!cpu_.saveSnapshot(checkpoints_.back().state, !full))
+    {
+        checkpoints_.pop_back();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Runs forward, taking a checkpoint each time interval cycles have been
+ * run past the last one.
+ */
+MSP430::STOP_REASON ReverseDebugger::run(const MSP430::RunLimits &limits)
+{
+    assert(!checkpoints_.empty());
+
+    while (true)
+    {
+        uint64_t next = checkpoints_.back().cycles + interval_;
+        MSP430::RunLimits segment = limits;
+
+        segment.cycles = std::min(limits.cycles, next);
+        MSP430::STOP_REASON reason = cpu_.runBounded(segment);
+        horizon_ = std::max(horizon_, cpu_.getCycles());
+
+        if ((reason != MSP430::STOP_CYCLES) || (cpu_.getCycles() < next))
+        {
+            return reason;
+        }
+
+        takeCheckpoint(false);
+        if (cpu_.getCycles() >= limits.cycles)
+        {
+            return MSP430::STOP_CYCLES;
+        }
+
+        // The next segment does not check its first instruction
+        if (limits.breakpoints && cpu_.isBreakpoint(cpu_.getPc()))
+        {
+            return MSP430::STOP_BREAKPOINT;
+        }
+        if (cpu_.getPc() == limits.pc)
+        {
+            return MSP430::STOP_TARGET_PC;
+        }
+    }
+}
+
+MSP430::STOP_REASON ReverseDebugger::runFor(uint64_t cycles)
+{
+    return run({cpu_.getCycles() + cycles, MSP430::NO_LIMIT,
+                MSP430::NO_TARGET_PC, true});
+}
+
+MSP430::STOP_REASON ReverseDebugger::step(uint64_t count)
+{
+    return run({MSP430::NO_LIMIT, getPosition() + count, MSP430::NO_TARGET_PC,
+                true});
+}
+
+/**
+ * Restores a checkpoint, the inputs being replayed from there up to the
+ * furthest point run.
+ */
+void ReverseDebugger::restore(const Checkpoint &checkpoint)
+{
+    InputLog &inputs = cpu_.getDevicesManager().getInputLog();
+
+    inputs.startReplay(inputs.getLog(), horizon_);
+    cpu_.restoreSnapshot(checkpoint.state);
+}
+
+bool ReverseDebugger::seek(uint64_t position)
+{
+    assert(!checkpoints_.empty());
+
+    bool reachable = (position >= checkpoints_.front().position);
+    if (!reachable)
+    {
+        position = checkpoints_.front().position;
+    }
+
+    // Last checkpoint at or before position
+    auto checkpoint = std::upper_bound(
+        checkpoints_.begin(), checkpoints_.end(), position,
+        [](uint64_t value, const Checkpoint &c) { return value < c.position; });
+    restore(*(checkpoint - 1));
+
+    if (getPosition() < position)
+    {
+        cpu_.runBounded(
+            {MSP430::NO_LIMIT, position, MSP430::NO_TARGET_PC, false});
+        // Inputs are recorded again past the horizon, keep them replayed
+        horizon_ = std::max(horizon_, cpu_.getCycles());
+    }
+    return reachable;
+}
+
+bool ReverseDebugger::reverseStep(uint64_t count)
+{
+    uint64_t position = getPosition();
+
+    return seek((count > position) ? 0 : position - count) &&
+           (count <= position);
+}
+
+/**
+ * Position of the last breakpoint or watchpoint stop before end, found by
+ * running again the checkpoint intervals, from the latest one.
+ */
+uint64_t ReverseDebugger::findLastStop(uint64_t end)
+{
+    auto checkpoint = std::lower_bound(
+        checkpoints_.begin(), checkpoints_.end(), end,
+        [](const Checkpoint &c, uint64_t value) { return c.position < value; });
+
+    while (checkpoint != checkpoints_.begin())
+    {
+        uint64_t last = NOT_FOUND;
+
+        checkpoint--;
+        restore(*checkpoint);
+
+        // Not checked by runBounded() on the first instruction
+        if (cpu_.isBreakpoint(cpu_.getPc()))
+        {
+            last = getPosition();
+        }
+
+        while (true)
+        {
+            MSP430::STOP_REASON reason = cpu_.runBounded(
+                {MSP430::NO_LIMIT, end, MSP430::NO_TARGET_PC, true});
+
+            if (reason == MSP430::STOP_BREAKPOINT)
+            {
+                last = getPosition();
+            }
+            else if (reason == MSP430::STOP_WATCHPOINT)
+            {
+                // Instructions writing to memory are never repeated
+                last = getPosition() - 1;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        if (last != NOT_FOUND)
+        {
+            return last;
+        }
+        end = checkpoint->position;
+    }
+    return NOT_FOUND;
+}
+
+bool ReverseDebugger::reverseContinue()
+{
+    uint64_t position = findLastStop(getPosition());
+
+    if (position == NOT_FOUND)
+    {
+        seek(checkpoints_.front().position);
+        return false;
+    }
+    return seek(position);
+}
+
+bool ReverseDebugger::runBackToWrite(uint32_t address)
+{
+    cpu_.addWatchpoint(address);
+    bool found = reverseContinue();
+    cpu_.removeWatchpoint(address);
+    return found;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "MSP430.h"
+
+/**
+ * Reverse execution by re-execution from periodic checkpoints.
+ *
+ * Forward runs go through the debugger, which takes an incremental snapshot
+ * every interval cycles and records the external inputs. Going back to an
+ * earlier position restores the last checkpoint before it and runs forward
+ * again up to it, replaying the recorded inputs: execution being
+ * deterministic, the machine gets back exactly the state it had there.
+ *
+ * Positions are counts of executed instructions. The debugger owns the
+ * memory checkpoint of the machine: no other full snapshot may be taken,
+ * and the machine must not be changed outside of the debugger, during a
+ * session.
+ */
+class ReverseDebugger
+{
+public:
+    static constexpr uint64_t DEFAULT_INTERVAL = 100000; // cycles
+
+    explicit ReverseDebugger(MSP430 &cpu,
+                             uint64_t interval = DEFAULT_INTERVAL);
+
+    // Starts a session at the current state, dropping the previous one
+    bool start();
+    uint64_t getPosition() const { return cpu_.getExecutedInstructions(); }
+
+    // Forward runs, see MSP430::runBounded()
+    MSP430::STOP_REASON run(const MSP430::RunLimits &limits);
+    MSP430::STOP_REASON runFor(uint64_t cycles);
+    MSP430::STOP_REASON step(uint64_t count = 1);
+
+    // Backward moves. They return false if the session start is reached
+    // first, the machine being left there. seek() can also move forward,
+    // past the furthest point run.
+    bool seek(uint64_t position);
+    bool reverseStep(uint64_t count = 1);
+    // Back to the last breakpoint, or to the last instruction writing to a
+    // watchpoint, before the current position
+    bool reverseContinue();
+    bool runBackToWrite(uint32_t address);
+
+private:
+    struct Checkpoint
+    {
+        uint64_t position;
+        uint64_t cycles;
+        std::vector<uint8_t> state;
+    };
+
+    static constexpr uint64_t NOT_FOUND = UINT64_MAX;
+
+    bool takeCheckpoint(bool full);
+    void restore(const Checkpoint &checkpoint);
+    uint64_t findLastStop(uint64_t end);
+
+    MSP430 &cpu_;
+    uint64_t interval_;
+    std::vector<Checkpoint> checkpoints_; // in execution order
+    uint64_t horizon_; // furthest cycle run, inputs are recorded past it
+};
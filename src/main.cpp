@@ -21,13 +21,9 @@ void loadPeripherals(MSP430 &uC)
 
     for (const auto &peripheral : peripherals)
     {
-        assert(peripheral->port <= 8);
+        assert((peripheral->port >= 1) && (peripheral->port <= 8));
 
-        TxCBType txCb = std::bind(&Peripheral::txCb, peripheral.get(),
-                                  std::placeholders::_1);
-        RxCBType rxCb = std::bind(&Peripheral::rxCb, peripheral.get());
-
-        dm.registerPeripheral(peripheral->port - 1, rxCb, txCb);
+        dm.attachPeripheral(peripheral->port, peripheral.get());
     }
 }
 
@@ -71,6 +67,7 @@ int main(int argc, char *argv[])
     int ret = app.exec();
 
     // Wait for the microcontroller thread to finish
+    uC.requestStop();
     uC_thread.join();
 
     return ret;
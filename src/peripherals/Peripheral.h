@@ -1,16 +1,35 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
+// Output of a port written by the firmware, and the CPU cycle it was at
+struct PinChange
+{
+    uint64_t cycle;
+    uint8_t value;
+};
+
 class Peripheral
 {
 public:
     Peripheral(){};
-    ~Peripheral(){};
+    virtual ~Peripheral(){};
 
     // MSP430 port number the device is connected to
     uint8_t port;
 
     virtual void txCb(uint8_t value) = 0;
     virtual uint8_t rxCb() = 0;
+
+    // Output changes of the port, in time order. Ports deliver them in
+    // batches, at the latest before the firmware reads the port inputs
+    // and when a run returns. Calls txCb() for each change by default.
+    virtual void onPinChanges(const PinChange *changes, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            txCb(changes[i].value);
+        }
+    }
 };
@@ -1,5 +1,5 @@
 #include "Uart.h"
-#include <stdio.h>
+#include "MSP430Trace.h"
 
 Uart::Uart() : Peripheral() { port = 3; }
 
@@ -9,11 +9,11 @@ void Uart::txCb(uint8_t value)
 {
     if (value & 0x10)
     {
-        printf("uart tx bit set\n");
+        TRACE_DEBUG(TRACE_PORT, "uart tx bit set\n");
     }
     else
     {
-        printf("uart tx bit unset\n");
+        TRACE_DEBUG(TRACE_PORT, "uart tx bit unset\n");
     }
 }
 
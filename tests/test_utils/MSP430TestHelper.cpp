@@ -17,6 +17,11 @@ void MSP430TestHelper::testRunInstruction(Instruction *instr)
     runOneInstruction(instr);
 }
 
+void MSP430TestHelper::testRunSelectedHandler(Instruction *instr)
+{
+    selectHandler(*instr)(this, instr);
+}
+
 uint32_t MSP430TestHelper::testGetRegister(uint8_t reg)
 {
     return getRegister(reg);
@@ -47,6 +52,10 @@ void MSP430TestHelper::testLoadCode(const uint16_t *code, const size_t codeSize)
         mem->writeByte(2 * i + 1, code[i] >> 8);
     }
 
+    // Code is written behind the bus, drop any cached decoding
+    decodeCache_.flush();
+    blockCache_.flush();
+
     setRegister(REG_IDX_PC, 0);
     setRegister(REG_IDX_SP, 32);
 }
@@ -57,3 +66,35 @@ bool MSP430TestHelper::testLoadROM(const std::string romFile)
 }
 
 void MSP430TestHelper::testRegDump() { regDump(); }
+
+void MSP430TestHelper::testBusWriteWord(uint32_t address, uint16_t value)
+{
+    devicesManager_.writeWord(address, value);
+}
+
+void MSP430TestHelper::testRunBlocks(size_t count)
+{
+    Block *block = nullptr;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        block = runNextBlock(block);
+    }
+}
+
+Instruction MSP430TestHelper::testDecodeStaticInstruction(uint32_t pc,
+                                                          bool reference)
+{
+    Instruction instr;
+
+    setRegister(REG_IDX_PC, pc);
+    if (reference)
+    {
+        decodeReferenceInstruction(&instr);
+    }
+    else
+    {
+        decodeStaticInstruction(&instr);
+    }
+    return instr;
+}
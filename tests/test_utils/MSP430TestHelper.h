@@ -15,9 +15,13 @@ public:
     void testLoadCode(const uint16_t *code, const size_t codeSize);
     Instruction testDecodeInstruction();
     void testRunInstruction(Instruction *instr);
+    void testRunSelectedHandler(Instruction *instr);
     uint32_t testGetRegister(uint8_t reg);
     void testSetRegister(uint8_t reg, uint32_t value);
     uint8_t testDecodeMajorOpcode(uint16_t rawInstruction);
     std::shared_ptr<Memory> testGetMemory();
     void testRegDump();
+    void testBusWriteWord(uint32_t address, uint16_t value);
+    void testRunBlocks(size_t count);
+    Instruction testDecodeStaticInstruction(uint32_t pc, bool reference);
 };
@@ -0,0 +1,104 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "MSP430BatchRunner.h"
+
+// Flash image computing R5 = 2 * count by a loop, stored at 0x2000
+static std::vector<uint8_t> loopImage(uint16_t count)
+{
+    uint16_t code[] = {
+        0x4034, count,  // 0x3100: MOV #count, R4
+        0x4305,         // 0x3104: MOV #0, R5
+        0x5325,         // 0x3106: ADD #2, R5
+        0x8314,         // 0x3108: SUB #1, R4
+        0x23FD,         // 0x310A: JNZ 0x3106
+        0x4582, 0x2000, // 0x310C: MOV R5, &0x2000
+        0x3FFF,         // 0x3110: JMP $
+    };
+    std::vector<uint8_t> image;
+
+    for (uint16_t word : code)
+    {
+        image.push_back(word & 0xFF);
+        image.push_back(word >> 8);
+    }
+    return image;
+}
+
+TEST_CASE("Batch runner Tests", "[BATCH]")
+{
+    MSP430BatchRunner runner(4);
+
+    REQUIRE(runner.getNbWorkers() == 4);
+
+    SECTION("Every job runs once, on a machine in its power up state")
+    {
+        const size_t nbJobs = 500;
+        std::vector<uint16_t> results(nbJobs);
+        // Not a vector<bool>, its bits would be written concurrently
+        std::vector<uint8_t> clean(nbJobs);
+        std::atomic<int> txCalls(0);
+        uint32_t powerUpPc = MSP430().getPc();
+
+        runner.run(nbJobs, [&](MSP430 &cpu, size_t index) {
+            DevicesManager &bus = cpu.getDevicesManager();
+
+            clean[index] = (bus.readWord(0x2000) == 0) &&
+                           (cpu.getCycles() == 0) && (cpu.getPc() == powerUpPc);
+
+            // Peripherals of the previous jobs are dropped
+            bus.registerPeripheral(3, [] { return 0; },
+                                   [&](uint8_t) { txCalls++; });
+            bus.writeByte(0x19, 0x01); // P3OUT
+
+            std::vector<uint8_t> image = loopImage(index % 100 + 1);
+            cpu.loadImage(image.data(), image.size(), 0x3100);
+            cpu.setPc(0x3100);
+            cpu.runUntil(0x3110);
+            results[index] = bus.readWord(0x2000);
+        });
+
+        for (size_t i = 0; i < nbJobs; i++)
+        {
+            REQUIRE(clean[i]);
+            REQUIRE(results[i] == 2 * (i % 100 + 1));
+        }
+        REQUIRE(txCalls == (int) nbJobs);
+    }
+
+    SECTION("Idle workers steal jobs from busy ones")
+    {
+        std::atomic<int> done(0);
+
+        // The first worker gets the slow jobs
+        runner.run(40, [&](MSP430 &, size_t index) {
+            if (index < 10)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            done++;
+        });
+        REQUIRE(done == 40);
+        REQUIRE(runner.getNbSteals() > 0);
+    }
+
+    SECTION("Job exceptions are rethrown once all jobs are done")
+    {
+        std::atomic<int> done(0);
+
+        REQUIRE_THROWS_AS(runner.run(20,
+                                     [&](MSP430 &, size_t index) {
+                                         done++;
+                                         if (index == 7)
+                                         {
+                                             throw std::runtime_error("job");
+                                         }
+                                     }),
+                          std::runtime_error);
+        REQUIRE(done == 20);
+    }
+}
@@ -0,0 +1,49 @@
+#include <catch2/catch.hpp>
+
+#include "MSP430InstructionHelper.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Basic block Tests", "[BLOCK]")
+{
+    // R5 = 2 * R4 computed by a loop
+    uint16_t code[] = {
+        0x4034, 0x0003, // 0x00: MOV #3, R4
+        0x4305,         // 0x04: MOV #0, R5
+        0x5325,         // 0x06: ADD #2, R5
+        0x8314,         // 0x08: SUB #1, R4
+        0x23FD,         // 0x0A: JNZ 0x06
+        0x3FFF,         // 0x0C: JMP $
+    };
+
+    sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+
+    SECTION("Blocks follow taken and not-taken edges")
+    {
+        sim.testRunBlocks(1);
+        REQUIRE(sim.testGetRegister(4) == 2);
+        REQUIRE(sim.testGetRegister(5) == 2);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x06);
+
+        sim.testRunBlocks(2);
+        REQUIRE(sim.testGetRegister(4) == 0);
+        REQUIRE(sim.testGetRegister(5) == 6);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x0C);
+
+        sim.testRunBlocks(1);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x0C);
+    }
+
+    SECTION("Bus write to block code invalidates the block")
+    {
+        sim.testRunBlocks(4);
+        REQUIRE(sim.testGetRegister(5) == 6);
+
+        sim.testBusWriteWord(0x06, 0x5225); // ADD #4, R5
+        sim.testSetRegister(MSP430::REG_IDX_PC, 0);
+        sim.testRunBlocks(3);
+
+        REQUIRE(sim.testGetRegister(5) == 12);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x0C);
+    }
+}
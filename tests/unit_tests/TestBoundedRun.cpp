@@ -0,0 +1,80 @@
+#include <catch2/catch.hpp>
+
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Bounded run Tests", "[RUN]")
+{
+    // R5 = 2 * R4 computed by a loop
+    uint16_t code[] = {
+        0x4034, 0x0003, // 0x00: MOV #3, R4 (2 cycles)
+        0x4305,         // 0x04: MOV #0, R5 (1 cycle)
+        0x5325,         // 0x06: ADD #2, R5 (1 cycle)
+        0x8314,         // 0x08: SUB #1, R4 (1 cycle)
+        0x23FD,         // 0x0A: JNZ 0x06 (2 cycles)
+        0x3FFF,         // 0x0C: JMP $ (2 cycles)
+    };
+
+    sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+
+    SECTION("Step runs a given number of instructions")
+    {
+        REQUIRE(sim.step() == MSP430::STOP_INSTRUCTIONS);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x04);
+
+        REQUIRE(sim.step(3) == MSP430::STOP_INSTRUCTIONS);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x0A);
+        REQUIRE(sim.getExecutedInstructions() == 4);
+    }
+
+    SECTION("Run until a target PC")
+    {
+        REQUIRE(sim.runUntil(0x0C) == MSP430::STOP_TARGET_PC);
+        REQUIRE(sim.testGetRegister(5) == 6);
+        REQUIRE(sim.getCycles() == 15);
+
+        REQUIRE(sim.runUntil(0x40, 10) == MSP430::STOP_CYCLES);
+        REQUIRE(sim.getCycles() == 25);
+    }
+
+    SECTION("Run for a cycle budget stops on the first instruction after it")
+    {
+        REQUIRE(sim.runFor(8) == MSP430::STOP_CYCLES);
+        REQUIRE(sim.getCycles() == 8);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x08);
+        REQUIRE(sim.testGetRegister(5) == 4);
+    }
+
+    SECTION("Breakpoints stop before the instruction and can be resumed")
+    {
+        sim.addBreakpoint(0x08);
+
+        REQUIRE(sim.runFor(1000) == MSP430::STOP_BREAKPOINT);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x08);
+        REQUIRE(sim.testGetRegister(5) == 2);
+
+        REQUIRE(sim.runFor(1000) == MSP430::STOP_BREAKPOINT);
+        REQUIRE(sim.testGetRegister(5) == 4);
+
+        sim.removeBreakpoint(0x08);
+        REQUIRE(sim.runFor(1000) == MSP430::STOP_CYCLES);
+        REQUIRE(sim.testGetRegister(5) == 6);
+    }
+
+    SECTION("Stop requests end the next run at once")
+    {
+        sim.requestStop();
+        REQUIRE(sim.runFor(1000) == MSP430::STOP_REQUESTED);
+        REQUIRE(sim.getCycles() == 0);
+        REQUIRE(sim.runFor(2) == MSP430::STOP_CYCLES);
+    }
+
+    SECTION("CPU off with nothing to wake it halts the run")
+    {
+        uint16_t lpm[] = {0xD032, 0x0010}; // BIS #CPUOFF, SR
+
+        sim.testLoadCode(lpm, 2);
+        REQUIRE(sim.runFor(1000) == MSP430::STOP_HALT);
+        REQUIRE(sim.getCycles() == 2);
+    }
+}
@@ -0,0 +1,162 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "msp430emu.h"
+
+struct PortPeripheral
+{
+    int reads;
+    std::vector<uint8_t> outputs;
+};
+
+static uint8_t portRx(void *context)
+{
+    static_cast<PortPeripheral *>(context)->reads++;
+    return 0xA4;
+}
+
+static void portTx(void *context, uint8_t value)
+{
+    static_cast<PortPeripheral *>(context)->outputs.push_back(value);
+}
+
+TEST_CASE("C API Tests", "[CAPI]")
+{
+    // R5 = 2 * R4 computed by a loop, stored at 0x2000
+    uint16_t code[] = {
+        0x4305,         // 0x3100: MOV #0, R5
+        0x5325,         // 0x3102: ADD #2, R5
+        0x8314,         // 0x3104: SUB #1, R4
+        0x23FD,         // 0x3106: JNZ 0x3102
+        0x4582, 0x2000, // 0x3108: MOV R5, &0x2000
+        0x3FFF,         // 0x310C: JMP $
+    };
+    std::vector<uint8_t> image;
+    for (uint16_t word : code)
+    {
+        image.push_back(word & 0xFF);
+        image.push_back(word >> 8);
+    }
+
+    msp430emu *emu = msp430emu_create();
+    REQUIRE(emu != nullptr);
+    REQUIRE(msp430emu_abi_version() == MSP430EMU_ABI_VERSION);
+    REQUIRE(msp430emu_load_image(emu, image.data(), image.size(), 0x3100,
+                                 0x3100) == MSP430EMU_OK);
+    REQUIRE(msp430emu_write_register(emu, 4, 10) == MSP430EMU_OK);
+
+    SECTION("Bounded runs, registers and memory")
+    {
+        uint32_t value;
+        uint8_t result[2];
+
+        REQUIRE(msp430emu_run(emu, MSP430EMU_NO_LIMIT, 1,
+                              MSP430EMU_NO_TARGET_PC) ==
+                MSP430EMU_STOP_INSTRUCTIONS);
+        REQUIRE(msp430emu_get_instructions(emu) == 1);
+
+        REQUIRE(msp430emu_run(emu, MSP430EMU_NO_LIMIT, MSP430EMU_NO_LIMIT,
+                              0x310C) == MSP430EMU_STOP_TARGET_PC);
+        REQUIRE(msp430emu_read_register(emu, 5, &value) == MSP430EMU_OK);
+        REQUIRE(value == 20);
+        REQUIRE(msp430emu_read_memory(emu, 0x2000, result, 2) ==
+                MSP430EMU_OK);
+        REQUIRE(result[0] == 20);
+        REQUIRE(result[1] == 0);
+
+        uint64_t cycles = msp430emu_get_cycles(emu);
+        REQUIRE(msp430emu_run(emu, 100, MSP430EMU_NO_LIMIT,
+                              MSP430EMU_NO_TARGET_PC) ==
+                MSP430EMU_STOP_CYCLES);
+        REQUIRE(msp430emu_get_cycles(emu) == cycles + 100);
+    }
+
+    SECTION("Breakpoints")
+    {
+        uint32_t pc;
+
+        REQUIRE(msp430emu_add_breakpoint(emu, 0x3108) == MSP430EMU_OK);
+        REQUIRE(msp430emu_run(emu, 1000, MSP430EMU_NO_LIMIT,
+                              MSP430EMU_NO_TARGET_PC) ==
+                MSP430EMU_STOP_BREAKPOINT);
+        REQUIRE(msp430emu_read_register(emu, 0, &pc) == MSP430EMU_OK);
+        REQUIRE(pc == 0x3108);
+    }
+
+    SECTION("Peripheral callbacks")
+    {
+        PortPeripheral peripheral = {0, {}};
+        uint8_t setup[] = {0xFF, 0x00}; // P3OUT, P3DIR
+        uint8_t input;
+
+        REQUIRE(msp430emu_register_peripheral(emu, 3, portRx, portTx,
+                                              &peripheral) == MSP430EMU_OK);
+        REQUIRE(msp430emu_write_memory(emu, 0x10, setup, 1) ==
+                MSP430EMU_OK); // P3REN
+        REQUIRE(msp430emu_write_memory(emu, 0x19, setup, 2) ==
+                MSP430EMU_OK);
+        REQUIRE(peripheral.outputs.size() == 1);
+
+        REQUIRE(msp430emu_read_memory(emu, 0x18, &input, 1) ==
+                MSP430EMU_OK); // P3IN
+        REQUIRE(peripheral.reads == 1);
+        // The input ORed with the output latch, bit 0 set by the port
+        REQUIRE(input == 0xA5);
+
+        REQUIRE(msp430emu_register_peripheral(emu, 9, portRx, portTx,
+                                              nullptr) ==
+                MSP430EMU_ERROR_ARGUMENT);
+    }
+
+    SECTION("Snapshots")
+    {
+        size_t size = 0;
+        uint32_t value;
+
+        REQUIRE(msp430emu_save_snapshot(emu, nullptr, &size) ==
+                MSP430EMU_ERROR_BUFFER_SIZE);
+        std::vector<uint8_t> snapshot(size);
+        REQUIRE(msp430emu_save_snapshot(emu, snapshot.data(), &size) ==
+                MSP430EMU_OK);
+
+        msp430emu_run(emu, MSP430EMU_NO_LIMIT, MSP430EMU_NO_LIMIT, 0x310C);
+        REQUIRE(msp430emu_restore_snapshot(emu, snapshot.data(), size) ==
+                MSP430EMU_OK);
+        REQUIRE(msp430emu_get_cycles(emu) == 0);
+        REQUIRE(msp430emu_read_register(emu, 4, &value) == MSP430EMU_OK);
+        REQUIRE(value == 10);
+
+        REQUIRE(msp430emu_restore_snapshot(emu, snapshot.data(), 4) ==
+                MSP430EMU_ERROR_FAILED);
+    }
+
+    SECTION("Invalid arguments")
+    {
+        uint32_t value;
+
+        REQUIRE(msp430emu_read_register(emu, 16, &value) ==
+                MSP430EMU_ERROR_ARGUMENT);
+        REQUIRE(msp430emu_read_memory(emu, 0x1FFFFF, image.data(), 2) ==
+                MSP430EMU_ERROR_ARGUMENT);
+        REQUIRE(msp430emu_read_memory(emu, 0x1FFFFF, image.data(), 1) ==
+                MSP430EMU_ERROR_ARGUMENT);
+        REQUIRE(msp430emu_read_memory(emu, 0x1FFFFE, image.data(), 1) ==
+                MSP430EMU_OK);
+        REQUIRE(msp430emu_write_memory(emu, 0x1FFFFE, image.data(), 2) ==
+                MSP430EMU_ERROR_ARGUMENT);
+        REQUIRE(msp430emu_load_image(emu, image.data(), image.size(),
+                                     0x1FFFF8, 0x3100) ==
+                MSP430EMU_ERROR_ARGUMENT);
+
+        // The watchdog only has word accessors
+        uint8_t wdtctl[2];
+        REQUIRE(msp430emu_read_memory(emu, 0x120, wdtctl, 2) ==
+                MSP430EMU_OK);
+        REQUIRE(wdtctl[1] == 0x69);
+        REQUIRE(msp430emu_write_memory(emu, 0x120, wdtctl, 1) ==
+                MSP430EMU_ERROR_ARGUMENT);
+        REQUIRE(msp430emu_run(nullptr, 1, 1, 0) == MSP430EMU_ERROR_ARGUMENT);
+    }
+
+    msp430emu_destroy(emu);
+}
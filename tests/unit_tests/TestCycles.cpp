@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+
+#include "MSP430DecodeTable.h"
+#include "MSP430InstructionHelper.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Cycle accounting Tests", "[CYCLES]")
+{
+    SECTION("Decode table cycles")
+    {
+        REQUIRE(decodeTable[0x4405].cycles == 1); // MOV R4, R5
+        REQUIRE(decodeTable[0x5325].cycles == 1); // ADD #2, R5
+        REQUIRE(decodeTable[0x4035].cycles == 2); // MOV #N, R5
+        REQUIRE(decodeTable[0x5425].cycles == 2); // ADD @R4, R5
+        REQUIRE(decodeTable[0x4215].cycles == 3); // MOV &A, R5
+        REQUIRE(decodeTable[0x5400].cycles == 3); // ADD R4, PC
+        REQUIRE(decodeTable[0x5482].cycles == 4); // ADD R4, &A
+        REQUIRE(decodeTable[0x4482].cycles == 3); // MOV R4, &A
+        REQUIRE(decodeTable[0x5495].cycles == 6); // ADD x(R4), y(R5)
+        REQUIRE(decodeTable[0x3FFF].cycles == 2); // JMP $
+        REQUIRE(decodeTable[0x151A].cycles == 4); // PUSHM.W #2, R10
+        REQUIRE(decodeTable[0x141A].cycles == 6); // PUSHM.A #2, R10
+        REQUIRE(decodeTable[0x04C5].cycles == 1); // MOVA R4, R5
+        REQUIRE(decodeTable[0x1300].cycles == 5); // RETI
+    }
+
+    SECTION("Extension word costs one cycle")
+    {
+        uint16_t code[] = {0x1840, 0x4405}; // MOVX.A R4, R5
+
+        sim.testLoadCode(code, 2);
+        REQUIRE(sim.testDecodeInstruction().cycles == 2);
+    }
+
+    SECTION("Extended format II register instructions take two cycles")
+    {
+        uint16_t rrcx[] = {0x1840, 0x1005}; // RRCX R5
+        uint16_t rrax[] = {0x1840, 0x1105}; // RRAX R5
+
+        sim.testLoadCode(rrcx, 2);
+        REQUIRE(sim.testDecodeInstruction().cycles == 2);
+        sim.testLoadCode(rrax, 2);
+        REQUIRE(sim.testDecodeInstruction().cycles == 2);
+    }
+
+    // R5 = 2 * R4 computed by a loop
+    uint16_t code[] = {
+        0x4034, 0x0003, // 0x00: MOV #3, R4 (2 cycles)
+        0x4305,         // 0x04: MOV #0, R5 (1 cycle)
+        0x5325,         // 0x06: ADD #2, R5 (1 cycle)
+        0x8314,         // 0x08: SUB #1, R4 (1 cycle)
+        0x23FD,         // 0x0A: JNZ 0x06 (2 cycles)
+        0x3FFF,         // 0x0C: JMP $ (2 cycles)
+    };
+
+    SECTION("Executed blocks account their cycles")
+    {
+        sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+        REQUIRE(sim.getCycles() == 0);
+
+        sim.testRunBlocks(1);
+        REQUIRE(sim.getCycles() == 7);
+
+        sim.testRunBlocks(3);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x0C);
+        REQUIRE(sim.getCycles() == 17);
+    }
+
+    SECTION("Translated blocks account the same cycles")
+    {
+        if (!sim.setExecutionBackend(MSP430::BACKEND_JIT))
+        {
+            return;
+        }
+
+        code[1] = 100;
+        sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+        sim.testRunBlocks(101);
+        REQUIRE(sim.testGetRegister(5) == 200);
+        REQUIRE(sim.getCycles() == 3 + 100 * 4 + 2);
+    }
+}
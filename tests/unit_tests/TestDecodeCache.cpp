@@ -0,0 +1,44 @@
+#include <catch2/catch.hpp>
+
+#include "MSP430InstructionHelper.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Decode cache Tests", "[CACHE]")
+{
+    SECTION("Cached instruction resolves current register values")
+    {
+        uint16_t code[] = {0x5405}; // ADD R4, R5
+        sim.testSetRegister(4, 0x10);
+        sim.testSetRegister(5, 0x20);
+
+        loadCodeAndRun(code, sizeof(code));
+        REQUIRE(sim.testGetRegister(5) == 0x30);
+
+        // Second run hits the cache
+        sim.testSetRegister(MSP430::REG_IDX_PC, 0);
+        Instruction instr = sim.testDecodeInstruction();
+        sim.testRunInstruction(&instr);
+
+        REQUIRE(instr.size == 2);
+        REQUIRE(sim.testGetRegister(5) == 0x40);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 2);
+    }
+
+    SECTION("Bus write to an extension word invalidates the cache")
+    {
+        uint16_t code[] = {0x4034, 0x1234}; // MOV #0x1234, R4
+
+        Instruction instr = loadCodeAndRun(code, sizeof(code));
+        REQUIRE(instr.size == 4);
+        REQUIRE(sim.testGetRegister(4) == 0x1234);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 4);
+
+        sim.testBusWriteWord(2, 0x5678);
+        sim.testSetRegister(MSP430::REG_IDX_PC, 0);
+        instr = sim.testDecodeInstruction();
+        sim.testRunInstruction(&instr);
+
+        REQUIRE(sim.testGetRegister(4) == 0x5678);
+    }
+}
@@ -0,0 +1,101 @@
+#include <catch2/catch.hpp>
+#include <string.h>
+
+#include "MSP430DecodeTable.h"
+#include "MSP430InstructionHelper.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+static constexpr uint32_t CODE_ADDRESS = 0x2000;
+
+static void writeCode(MSP430TestHelper &sim, const uint16_t *code, size_t size)
+{
+    auto mem = sim.testGetMemory();
+
+    for (size_t i = 0; i < size; i++)
+    {
+        mem->writeByte(CODE_ADDRESS + 2 * i, code[i] & 0xFF);
+        mem->writeByte(CODE_ADDRESS + 2 * i + 1, code[i] >> 8);
+    }
+}
+
+// Decodes the code at CODE_ADDRESS with the table and the reference decoder
+static bool decodersAgree(MSP430TestHelper &sim)
+{
+    Instruction table = sim.testDecodeStaticInstruction(CODE_ADDRESS, false);
+    uint32_t tablePc = sim.testGetRegister(MSP430::REG_IDX_PC);
+    Instruction reference =
+        sim.testDecodeStaticInstruction(CODE_ADDRESS, true);
+    uint32_t referencePc = sim.testGetRegister(MSP430::REG_IDX_PC);
+
+    return (memcmp(&table, &reference, sizeof(Instruction)) == 0) &&
+           (tablePc == referencePc);
+}
+
+TEST_CASE_METHOD(MSP430TestFixture, "Decode table Tests", "[DECODE_TABLE]")
+{
+    SECTION("Table matches the reference decoder on every first word")
+    {
+        for (uint32_t raw = 0; raw < NB_DECODE_ENTRIES; raw++)
+        {
+            const DecodeEntry &entry = decodeTable[raw];
+            uint16_t code[] = {(uint16_t) raw, 0x1234, 0x5678};
+
+            if ((entry.kind == DECODE_KIND_INVALID) ||
+                (entry.kind == DECODE_KIND_PREFIX))
+            {
+                continue;
+            }
+
+            writeCode(sim, code, 3);
+            CAPTURE(raw);
+            REQUIRE(decodersAgree(sim));
+            REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) ==
+                    CODE_ADDRESS + 2 * entry.nbExtWords);
+        }
+    }
+
+    SECTION("Table matches the reference decoder on extended words")
+    {
+        // A.L/B.W = 0/0 is reserved: 0x1800 only prefixes byte core words
+        const uint16_t prefixes[] = {0x1800, 0x1840, 0x18C5, 0x1D47, 0x1C4F};
+
+        for (uint16_t prefix : prefixes)
+        {
+            for (uint32_t raw = 0x2000; raw < NB_DECODE_ENTRIES; raw++)
+            {
+                uint16_t code[] = {prefix, (uint16_t) raw, 0x1234, 0x5678};
+
+                if (!(prefix & 0x40) && !(raw & 0x40))
+                {
+                    continue;
+                }
+
+                writeCode(sim, code, 4);
+                CAPTURE(prefix, raw);
+                REQUIRE(decodersAgree(sim));
+            }
+        }
+    }
+
+    SECTION("Table entries")
+    {
+        // MOV #0x1234, R5
+        const DecodeEntry &mov = decodeTable[0x4035];
+        REQUIRE(mov.kind == DECODE_KIND_CORE);
+        REQUIRE(mov.handler == DECODE_HANDLER_MOV);
+        REQUIRE(mov.source.addrMode == ADDR_MODE_IMMEDIATE);
+        REQUIRE(mov.destination.addrMode == ADDR_MODE_REGISTER);
+        REQUIRE(mov.nbExtWords == 1);
+
+        // ADD #2, R5 (constant generator)
+        const DecodeEntry &add = decodeTable[0x5325];
+        REQUIRE(add.handler == DECODE_HANDLER_ADD);
+        REQUIRE(add.source.value == 2);
+        REQUIRE(add.source.flags & DECODE_OPD_CONSTANT_GENERATOR);
+        REQUIRE(add.nbExtWords == 0);
+
+        REQUIRE(decodeTable[0x1840].kind == DECODE_KIND_PREFIX);
+        REQUIRE(decodeTable[0x0000].kind == DECODE_KIND_INVALID);
+    }
+}
@@ -0,0 +1,76 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Dirty pages Tests", "[DIRTY]")
+{
+    DevicesManager &bus = sim.getDevicesManager();
+    auto memory = sim.testGetMemory();
+    std::vector<uint8_t> full;
+    std::vector<uint8_t> incremental;
+
+    // Memory is not cleared at power up
+    bus.writeWord(0x2000, 0);
+    bus.writeWord(0x3000, 0);
+    REQUIRE(memory->getNbDirtyPages() == Memory::NB_PAGES);
+    REQUIRE(sim.saveSnapshot(full));
+    REQUIRE(memory->getNbDirtyPages() == 0);
+
+    SECTION("Writes dirty their page once")
+    {
+        bus.writeWord(0x2000, 0x1111);
+        bus.writeWord(0x2002, 0x2222);
+        bus.writeByte(0x21FF, 0x33);
+        REQUIRE(memory->getNbDirtyPages() == 1);
+
+        memory->writeDWord(0x23FE, 0x44444444);
+        REQUIRE(memory->getNbDirtyPages() == 3);
+        REQUIRE(bus.readWord(0x2002) == 0x2222);
+    }
+
+    SECTION("Restoring the checkpoint only rewrites dirty pages")
+    {
+        uint16_t original = bus.readWord(0x8000);
+
+        bus.writeWord(0x2000, 0x1234);
+        bus.writeWord(0x8000, original + 1);
+        REQUIRE(sim.restoreSnapshot(full));
+
+        REQUIRE(memory->getNbDirtyPages() == 0);
+        REQUIRE(bus.readWord(0x2000) == 0);
+        REQUIRE(bus.readWord(0x8000) == original);
+
+        // The pages are tracked again after the restore
+        bus.writeWord(0x2000, 0x1234);
+        REQUIRE(memory->getNbDirtyPages() == 1);
+    }
+
+    SECTION("Incremental snapshots hold the dirty pages only")
+    {
+        bus.writeWord(0x2000, 0x0001);
+        REQUIRE(sim.saveSnapshot(incremental, true));
+        REQUIRE(incremental.size() < 2 * Memory::PAGE_SIZE);
+
+        bus.writeWord(0x2000, 0x0002);
+        bus.writeWord(0x3000, 0x0003);
+        REQUIRE(sim.restoreSnapshot(incremental));
+        REQUIRE(bus.readWord(0x2000) == 0x0001);
+        REQUIRE(bus.readWord(0x3000) == 0);
+        REQUIRE(memory->getNbDirtyPages() == 1);
+
+        REQUIRE(sim.restoreSnapshot(full));
+        REQUIRE(bus.readWord(0x2000) == 0);
+        REQUIRE(sim.restoreSnapshot(incremental));
+        REQUIRE(bus.readWord(0x2000) == 0x0001);
+    }
+
+    SECTION("Incremental snapshots need their checkpoint")
+    {
+        bus.writeWord(0x2000, 0x0001);
+        REQUIRE(sim.saveSnapshot(incremental, true));
+        REQUIRE(sim.saveSnapshot(full));
+        REQUIRE_FALSE(sim.restoreSnapshot(incremental));
+    }
+}
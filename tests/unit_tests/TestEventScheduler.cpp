@@ -0,0 +1,112 @@
+#include <catch2/catch.hpp>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+#include "Device.h"
+#include "EventScheduler.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+// Device recording the events it receives
+class EventRecorder : public Device
+{
+public:
+    EventRecorder() : Device(0, 0, "recorder") {}
+
+    void init() override {}
+    void destroy() override {}
+    uint16_t readWord(uint32_t address) override { return 0; }
+    void writeWord(uint32_t address, uint16_t value) override {}
+
+    void onEvent(uint64_t time, uint32_t tag) override
+    {
+        events.push_back({time, tag});
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t>> events;
+};
+
+TEST_CASE_METHOD(MSP430TestFixture, "Event scheduler Tests", "[SCHEDULER]")
+{
+    EventScheduler scheduler;
+    EventRecorder recorder;
+
+    SECTION("Events fire in time then posting order")
+    {
+        scheduler.post(30, &recorder, 3);
+        scheduler.post(10, &recorder, 1);
+        scheduler.post(20, &recorder, 2);
+        scheduler.post(10, &recorder, 4);
+        REQUIRE(scheduler.nextEventTime() == 10);
+
+        scheduler.run(20);
+        REQUIRE(recorder.events.size() == 3);
+        REQUIRE(recorder.events[0].second == 1);
+        REQUIRE(recorder.events[1].second == 4);
+        REQUIRE(recorder.events[2] == std::make_pair((uint64_t) 20, 2u));
+        REQUIRE(scheduler.nextEventTime() == 30);
+    }
+
+    SECTION("Events can be cancelled and rescheduled")
+    {
+        EventId first = scheduler.post(10, &recorder, 1);
+        EventId second = scheduler.post(20, &recorder, 2);
+        EventId third = scheduler.post(30, &recorder, 3);
+
+        REQUIRE(scheduler.cancel(first));
+        REQUIRE_FALSE(scheduler.cancel(first));
+        REQUIRE(scheduler.reschedule(third, 5));
+        REQUIRE(scheduler.reschedule(second, 50));
+        REQUIRE(scheduler.nextEventTime() == 5);
+
+        scheduler.run(40);
+        REQUIRE(recorder.events.size() == 1);
+        REQUIRE(recorder.events[0] == std::make_pair((uint64_t) 5, 3u));
+        REQUIRE_FALSE(scheduler.isPending(third));
+        REQUIRE(scheduler.isPending(second));
+
+        scheduler.run(50);
+        REQUIRE(recorder.events.size() == 2);
+        REQUIRE(scheduler.nextEventTime() == EventScheduler::NO_EVENT);
+    }
+
+    SECTION("Snapshots with invalid free ids are rejected")
+    {
+        std::vector<Device *> devices = {&recorder};
+        std::vector<uint8_t> state;
+        SnapshotWriter out(state);
+        EventScheduler restored;
+
+        EventId first = scheduler.post(10, &recorder, 1);
+        scheduler.post(20, &recorder, 2);
+        scheduler.cancel(first);
+        REQUIRE(scheduler.saveState(out, devices));
+
+        // The free id list ends the state, it holds id 0
+        for (EventId id : {0u, 1u, 2u})
+        {
+            memcpy(state.data() + state.size() - sizeof(id), &id,
+                   sizeof(id));
+            SnapshotReader check(state.data(), state.size());
+            SnapshotReader in(state.data(), state.size());
+
+            bool valid = (id == 0); // 1 is pending, 2 does not exist
+            REQUIRE(scheduler.checkState(check, devices.size()) == valid);
+            REQUIRE(restored.loadState(in, devices) == valid);
+        }
+    }
+
+    SECTION("Halted CPU wakes time up at the next event")
+    {
+        uint16_t code[] = {0xD032, 0x0010}; // BIS #CPUOFF, SR
+
+        sim.getDevicesManager().getScheduler().post(5000, &recorder, 7);
+        sim.testLoadCode(code, 2);
+        sim.testRunBlocks(2);
+
+        REQUIRE(sim.getCycles() == 5000);
+        REQUIRE(recorder.events.size() == 1);
+        REQUIRE(recorder.events[0] == std::make_pair((uint64_t) 5000, 7u));
+    }
+}
@@ -0,0 +1,86 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "MSP430InstructionHelper.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+static constexpr uint32_t DATA_ADDRESS = 0x2000;
+
+// Loads code and data, then decodes the instruction at address 0
+static Instruction prepare(MSP430TestHelper &sim,
+                           const std::vector<uint16_t> &code, uint32_t r4,
+                           uint32_t r5, uint16_t data, uint32_t sr)
+{
+    auto mem = sim.testGetMemory();
+
+    sim.testLoadCode(code.data(), code.size());
+    sim.testSetRegister(4, r4);
+    sim.testSetRegister(5, r5);
+    sim.testSetRegister(MSP430::REG_IDX_SR, sr);
+    mem->writeByte(DATA_ADDRESS, data & 0xFF);
+    mem->writeByte(DATA_ADDRESS + 1, data >> 8);
+    mem->writeByte(DATA_ADDRESS + 2, 0x34);
+    mem->writeByte(DATA_ADDRESS + 3, 0x92);
+    return sim.testDecodeInstruction();
+}
+
+TEST_CASE_METHOD(MSP430TestFixture, "Specialized handlers Tests",
+                 "[HANDLERS]")
+{
+    MSP430TestHelper reference;
+    const uint32_t values[][2] = {
+        {0x0000, 0x0000}, {0x0001, 0xFFFF}, {0x8000, 0x8000},
+        {0x1234, 0x0F0F}, {0x00FF, 0x0080}, {0x7FFF, 0x0001},
+    };
+
+    SECTION("Handlers match the generic execution")
+    {
+        for (uint32_t opcode = 0x4000; opcode <= 0xF000; opcode += 0x1000)
+        {
+            for (uint16_t bw : {0x0000, 0x0040})
+            {
+                const std::vector<uint16_t> programs[] = {
+                    {(uint16_t) (opcode | bw | 0x0405)},         // R4, R5
+                    {(uint16_t) (opcode | bw | 0x0402)},         // R4, SR
+                    {(uint16_t) (opcode | bw | 0x0035), 0x9876}, // #N, R5
+                    {(uint16_t) (opcode | bw | 0x0215), 0x2002}, // &A, R5
+                    {(uint16_t) (opcode | bw | 0x0482), 0x2000}, // R4, &A
+                    {(uint16_t) (opcode | bw | 0x00B2), 0x5AA5, 0x2000},
+                    // Extended R4, R5: word, or 20-bit with B/W set
+                    {(uint16_t) (bw ? 0x1800 : 0x1840),
+                     (uint16_t) (opcode | bw | 0x0405)},
+                };
+
+                for (const auto &code : programs)
+                {
+                    for (const auto &value : values)
+                    {
+                        for (uint32_t sr : {0x0, 0x1})
+                        {
+                            Instruction instr = prepare(sim, code, value[0],
+                                                        value[1], 0x4321, sr);
+                            Instruction refInstr =
+                                prepare(reference, code, value[0], value[1],
+                                        0x4321, sr);
+
+                            sim.testRunSelectedHandler(&instr);
+                            reference.testRunInstruction(&refInstr);
+
+                            CAPTURE(code[0], value[0], value[1], sr);
+                            for (uint8_t reg = 0; reg < 6; reg++)
+                            {
+                                REQUIRE(sim.testGetRegister(reg) ==
+                                        reference.testGetRegister(reg));
+                            }
+                            REQUIRE(
+                                sim.testGetMemory()->readWord(DATA_ADDRESS) ==
+                                reference.testGetMemory()->readWord(
+                                    DATA_ADDRESS));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "InputLog.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Input log Tests", "[INPUT_LOG]")
+{
+    SECTION("Changes are logged with their cycle and replayed")
+    {
+        InputLog log;
+        uint64_t clock = 0;
+        uint16_t inputs[] = {1, 1, 0x300, 0x300, 2};
+
+        log.setClock(&clock);
+        log.startRecording();
+        for (uint16_t input : inputs)
+        {
+            REQUIRE(log.sample(3, [&] { return input; }) == input);
+            clock += 1000;
+        }
+        log.stop();
+
+        // Header and 3 changes of up to 5 bytes
+        REQUIRE(log.getLog().size() <= 8 + 3 * 5);
+
+        clock = 0;
+        REQUIRE(log.startReplay(log.getLog()));
+        for (uint16_t input : inputs)
+        {
+            REQUIRE(log.sample(3, [] { return 0xFFFF; }) == input);
+            clock += 1000;
+        }
+        REQUIRE(log.isReplayFinished());
+    }
+
+    SECTION("Invalid logs are rejected")
+    {
+        InputLog log;
+        std::vector<uint8_t> invalid = {1, 2, 3, 4, 5, 6, 7, 8};
+
+        REQUIRE_FALSE(log.startReplay(invalid));
+        REQUIRE(log.getMode() == INPUT_LIVE);
+    }
+
+    SECTION("Port inputs are read on the input pins")
+    {
+        DevicesManager &bus = sim.getDevicesManager();
+        InputLog &log = bus.getInputLog();
+
+        bus.writeByte(0x12, 0xFF); // P5REN
+        bus.registerPeripheral(5, [] { return uint8_t(0x82); },
+                               [](uint8_t) {});
+
+        log.startRecording();
+        REQUIRE(bus.readByte(0x30) == 0x82); // P5IN
+        bus.writeByte(0x32, 0x80);           // P5DIR
+        REQUIRE(bus.readByte(0x30) == 0x02);
+        log.stop();
+
+        REQUIRE(log.startReplay(log.getLog()));
+        bus.writeByte(0x32, 0x00);
+        REQUIRE(bus.readByte(0x30) == 0x82);
+    }
+
+    SECTION("Port inputs of a run are replayed bit-exactly")
+    {
+        DevicesManager &bus = sim.getDevicesManager();
+        InputLog &log = bus.getInputLog();
+        uint16_t code[] = {
+            0x4255, 0x0030, // 0x00: MOV.B &P5IN, R5
+            0x5506,         // 0x04: ADD R5, R6
+            0x3FFC,         // 0x06: JMP 0x00
+        };
+        std::vector<uint8_t> snapshot;
+        int reads = 0;
+        uint32_t driven = 0;
+
+        sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+        sim.testSetRegister(6, 0);
+        bus.writeByte(0x12, 0xFF); // P5REN
+        bus.registerPeripheral(5,
+                               [&]
+                               {
+                                   uint8_t value =
+                                       ((reads++ / 7) & 1) ? 0xA5 : 0x5A;
+                                   driven += value;
+                                   return value;
+                               },
+                               [](uint8_t) {});
+        REQUIRE(sim.saveSnapshot(snapshot));
+
+        log.startRecording();
+        sim.step(300);
+        uint32_t recorded = sim.testGetRegister(6);
+        REQUIRE(reads == 100);
+        REQUIRE(recorded == driven);
+
+        REQUIRE(sim.restoreSnapshot(snapshot));
+        REQUIRE(log.startReplay(log.getLog()));
+        reads = 0;
+        sim.step(300);
+        REQUIRE(sim.testGetRegister(6) == recorded);
+        REQUIRE(reads == 0);
+        REQUIRE(log.isReplayFinished());
+    }
+}
@@ -0,0 +1,128 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "InterruptController.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Interrupts Tests", "[INTERRUPT]")
+{
+    DevicesManager &bus = sim.getDevicesManager();
+    InterruptController &interrupts = bus.getInterrupts();
+    uint16_t code[] = {
+        0xD032, 0x0018,         // 0x00: BIS #GIE|CPUOFF, SR
+        0x5314,                 // 0x04: ADD #1, R4
+        0x3FFF,                 // 0x06: JMP $
+    };
+    uint16_t handler[] = {
+        0x43C2, 0x0023,         // 0x2100: MOV.B #0, &P1IFG
+        0x5315,                 // 0x2104: ADD #1, R5
+        0xC0B1, 0x0010, 0x0000, // 0x2106: BIC #CPUOFF, 0(SP)
+        0x1300,                 // 0x210C: RETI
+    };
+
+    sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+    for (size_t i = 0; i < sizeof(handler) / sizeof(handler[0]); i++)
+    {
+        bus.writeWord(0x2100 + 2 * i, handler[i]);
+    }
+    for (uint8_t line = 0; line < InterruptController::NB_LINES; line++)
+    {
+        bus.writeWord(InterruptController::vectorAddress(line), 0x2100);
+    }
+    sim.testSetRegister(MSP430::REG_IDX_SP, 0x3000);
+    sim.testSetRegister(4, 0);
+    sim.testSetRegister(5, 0);
+
+    SECTION("A port interrupt wakes the CPU up, RETI resumes the program")
+    {
+        REQUIRE(sim.runFor(100) == MSP430::STOP_HALT);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x04);
+        uint64_t cycles = sim.getCycles();
+
+        bus.writeByte(0x25, 0x01); // P1IE
+        bus.writeByte(0x23, 0x01); // P1IFG
+        REQUIRE(interrupts.getPending() ==
+                (1u << InterruptController::LINE_PORT1));
+
+        REQUIRE(sim.runUntil(0x2100) == MSP430::STOP_TARGET_PC);
+        REQUIRE(sim.getCycles() == cycles + MSP430::INTERRUPT_CYCLES);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_SP) == 0x2FFC);
+        REQUIRE(bus.readWord(0x2FFE) == 0x04);
+        REQUIRE(bus.readWord(0x2FFC) == 0x18);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_SR) == 0);
+
+        REQUIRE(sim.runUntil(0x06, 100) == MSP430::STOP_TARGET_PC);
+        REQUIRE(sim.testGetRegister(5) == 1);
+        REQUIRE(sim.testGetRegister(4) == 1);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_SP) == 0x3000);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_SR) ==
+                MSP430::SR_GIE);
+        REQUIRE(interrupts.getPending() == 0);
+    }
+
+    SECTION("Maskable interrupts wait for GIE, by priority")
+    {
+        uint16_t loop[] = {
+            0x5314, // 0x00: ADD #1, R4
+            0x3FFE, // 0x02: JMP 0x00
+        };
+
+        sim.testLoadCode(loop, 2);
+        sim.testSetRegister(MSP430::REG_IDX_SP, 0x3000);
+        sim.testSetRegister(MSP430::REG_IDX_SR, 0);
+        bus.writeWord(
+            InterruptController::vectorAddress(
+                InterruptController::LINE_WATCHDOG),
+            0x2104);
+        interrupts.raise(InterruptController::LINE_PORT2);
+        interrupts.raise(InterruptController::LINE_WATCHDOG);
+
+        REQUIRE(sim.runUntil(0x2104, 100) == MSP430::STOP_CYCLES);
+        REQUIRE(sim.runUntil(0x2100, 100) == MSP430::STOP_CYCLES);
+
+        sim.testSetRegister(MSP430::REG_IDX_SR, MSP430::SR_GIE);
+        REQUIRE(sim.runUntil(0x2104, 100) == MSP430::STOP_TARGET_PC);
+        REQUIRE(interrupts.getPending() ==
+                (1u << InterruptController::LINE_PORT2));
+
+        // The handler returns with GIE set, the next one is taken
+        REQUIRE(sim.runUntil(0x2100, 100) == MSP430::STOP_TARGET_PC);
+        REQUIRE(interrupts.getPending() == 0);
+    }
+
+    SECTION("NMI is taken whatever GIE")
+    {
+        sim.testSetRegister(MSP430::REG_IDX_SR, 0);
+        interrupts.raise(InterruptController::LINE_NMI);
+        REQUIRE(sim.runUntil(0x2100, 100) == MSP430::STOP_TARGET_PC);
+    }
+
+    SECTION("RETI restores a 20-bit PC")
+    {
+        uint16_t reti[] = {0x1300};
+
+        sim.testLoadCode(reti, 1);
+        sim.testSetRegister(MSP430::REG_IDX_SP, 0x2FFC);
+        bus.writeWord(0x2FFC, 0x1000 | MSP430::SR_GIE);
+        bus.writeWord(0x2FFE, 0x2000);
+
+        sim.step();
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x12000);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_SR) == MSP430::SR_GIE);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_SP) == 0x3000);
+        REQUIRE(sim.getCycles() == 5);
+    }
+
+    SECTION("Pending interrupts are part of snapshots")
+    {
+        std::vector<uint8_t> snapshot;
+
+        interrupts.raise(InterruptController::LINE_WATCHDOG);
+        REQUIRE(sim.saveSnapshot(snapshot));
+        interrupts.clear(InterruptController::LINE_WATCHDOG);
+        REQUIRE(sim.restoreSnapshot(snapshot));
+        REQUIRE(interrupts.getPending() ==
+                (1u << InterruptController::LINE_WATCHDOG));
+    }
+}
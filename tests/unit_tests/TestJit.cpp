@@ -0,0 +1,198 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "Device.h"
+#include "InterruptController.h"
+#include "MSP430InstructionHelper.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+// Raises the interrupt line given as event tag when the event fires
+class InterruptSource : public Device
+{
+public:
+    InterruptSource() : Device(0, 0, "interrupt source") {}
+
+    void init() override {}
+    void destroy() override {}
+    uint16_t readWord(uint32_t address) override { return 0; }
+    void writeWord(uint32_t address, uint16_t value) override {}
+
+    void onEvent(uint64_t time, uint32_t tag) override
+    {
+        interrupts_->raise(tag);
+    }
+};
+
+TEST_CASE_METHOD(MSP430TestFixture, "JIT backend Tests", "[JIT]")
+{
+    // Loop mixing translated (MOV/BIS/BIC) and interpreted instructions
+    uint16_t code[] = {
+        0xD036, 0x00F0, // 0x00: BIS #0xF0, R6
+        0xC406,         // 0x04: BIC R4, R6
+        0x4607,         // 0x06: MOV R6, R7
+        0xD447,         // 0x08: BIS.B R4, R7
+        0x5705,         // 0x0A: ADD R7, R5
+        0x8314,         // 0x0C: SUB #1, R4
+        0x23F8,         // 0x0E: JNZ 0x00
+    };
+    MSP430TestHelper reference;
+
+    if (!sim.setExecutionBackend(MSP430::BACKEND_JIT))
+    {
+        WARN("JIT backend not supported on this host");
+        return;
+    }
+    REQUIRE(sim.getExecutionBackend() == MSP430::BACKEND_JIT);
+
+    sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+    reference.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+    sim.testSetRegister(4, 40);
+    sim.testSetRegister(6, 0x1234);
+    reference.testSetRegister(4, 40);
+    reference.testSetRegister(6, 0x1234);
+
+    SECTION("Translated blocks match the interpreter")
+    {
+        for (int i = 0; i < 40; i++)
+        {
+            sim.testRunBlocks(1);
+            reference.testRunBlocks(1);
+
+            for (uint8_t reg = 0; reg < MSP430::NB_REGISTERS; reg++)
+            {
+                REQUIRE(sim.testGetRegister(reg) ==
+                        reference.testGetRegister(reg));
+            }
+        }
+        REQUIRE(sim.testGetRegister(4) == 0);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x10);
+    }
+
+    SECTION("Memory operands match the interpreter")
+    {
+        // Loop over RAM data mixing addressing modes, with a peripheral
+        // write taking the slow path
+        uint16_t loop[] = {
+            0x4416, 0x0000,         // 0x3100: MOV 0(R4), R6
+            0x5324,                 // 0x3104: ADD #2, R4
+            0x5682, 0x2200,         // 0x3106: ADD R6, &0x2200
+            0x4689, 0x0000,         // 0x310A: MOV R6, 0(R9)
+            0x5329,                 // 0x310E: ADD #2, R9
+            0x90F4, 0x0010, 0x0001, // 0x3110: CMP.B #0x10, 1(R4)
+            0xF607,                 // 0x3116: AND R6, R7
+            0xE417, 0x0002,         // 0x3118: XOR 2(R4), R7
+            0xD258, 0x2300,         // 0x311C: BIS.B &0x2300, R8
+            0x46C2, 0x0019,         // 0x3120: MOV.B R6, &P3OUT
+            0x8315,                 // 0x3124: SUB #1, R5
+            0x23EC,                 // 0x3126: JNZ 0x3100
+            0x3FFF,                 // 0x3128: JMP $
+        };
+        std::vector<uint8_t> image;
+        for (uint16_t word : loop)
+        {
+            image.push_back(word & 0xFF);
+            image.push_back(word >> 8);
+        }
+
+        for (MSP430TestHelper *cpu : {&sim, &reference})
+        {
+            DevicesManager &bus = cpu->getDevicesManager();
+            for (uint32_t address = 0x2000; address < 0x2400; address += 2)
+            {
+                bus.writeWord(address, (address * 0x1111 + 3) & 0xFFFF);
+            }
+            cpu->loadImage(image.data(), image.size(), 0x3100);
+            cpu->setPc(0x3100);
+            cpu->testSetRegister(4, 0x2000);
+            cpu->testSetRegister(5, 40);
+            cpu->testSetRegister(7, 0xFFFF);
+            cpu->testSetRegister(9, 0x2100);
+        }
+        // Clean pages take the slow path until written once
+        std::vector<uint8_t> snapshot;
+        REQUIRE(sim.saveSnapshot(snapshot));
+
+        for (int i = 0; i < 41; i++)
+        {
+            sim.testRunBlocks(1);
+            reference.testRunBlocks(1);
+
+            for (uint8_t reg = 0; reg < MSP430::NB_REGISTERS; reg++)
+            {
+                REQUIRE(sim.testGetRegister(reg) ==
+                        reference.testGetRegister(reg));
+            }
+            REQUIRE(sim.getCycles() == reference.getCycles());
+            REQUIRE(sim.getExecutedInstructions() ==
+                    reference.getExecutedInstructions());
+        }
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x3128);
+
+        DevicesManager &bus = sim.getDevicesManager();
+        DevicesManager &referenceBus = reference.getDevicesManager();
+        for (uint32_t address = 0x2000; address < 0x2400; address++)
+        {
+            REQUIRE(bus.readByte(address) == referenceBus.readByte(address));
+        }
+        REQUIRE(bus.readByte(0x19) == referenceBus.readByte(0x19));
+    }
+
+    SECTION("Interrupts raised by device events match the interpreter")
+    {
+        uint16_t loop[] = {
+            0x5315, 0x5315, 0x5315, 0x5315, 0x5315, // 0x3100: ADD #1, R5
+            0x5315, 0x5315, 0x5315, 0x5315, 0x5315, // x10
+            0x3FF5,                                 // 0x3114: JMP 0x3100
+            0x5316,                                 // 0x3116: ADD #1, R6
+            0x1300,                                 // 0x3118: RETI
+        };
+        std::vector<uint8_t> image;
+        for (uint16_t word : loop)
+        {
+            image.push_back(word & 0xFF);
+            image.push_back(word >> 8);
+        }
+        InterruptSource sources[2];
+        MSP430TestHelper *cpus[] = {&sim, &reference};
+
+        for (int i = 0; i < 2; i++)
+        {
+            DevicesManager &bus = cpus[i]->getDevicesManager();
+
+            cpus[i]->loadImage(image.data(), image.size(), 0x3100);
+            bus.writeWord(InterruptController::vectorAddress(
+                              InterruptController::LINE_WATCHDOG),
+                          0x3116);
+            cpus[i]->setPc(0x3100);
+            cpus[i]->testSetRegister(MSP430::REG_IDX_SP, 0x3000);
+            cpus[i]->testSetRegister(MSP430::REG_IDX_SR, MSP430::SR_GIE);
+            cpus[i]->testSetRegister(5, 0);
+            cpus[i]->testSetRegister(6, 0);
+
+            // Due in the middle of a translated run
+            sources[i].attachInterrupts(&bus.getInterrupts());
+            bus.getScheduler().post(5005, &sources[i],
+                                    InterruptController::LINE_WATCHDOG);
+        }
+
+        for (int i = 0; i < 600; i++)
+        {
+            sim.testRunBlocks(1);
+            reference.testRunBlocks(1);
+
+            for (uint8_t reg = 0; reg < MSP430::NB_REGISTERS; reg++)
+            {
+                REQUIRE(sim.testGetRegister(reg) ==
+                        reference.testGetRegister(reg));
+            }
+            REQUIRE(sim.getCycles() == reference.getCycles());
+            REQUIRE(sim.getExecutedInstructions() ==
+                    reference.getExecutedInstructions());
+        }
+        REQUIRE(sim.testGetRegister(6) == 1);
+        // Return address pushed when the interrupt was taken
+        REQUIRE(sim.getDevicesManager().readWord(0x2FFE) ==
+                reference.getDevicesManager().readWord(0x2FFE));
+    }
+}
@@ -0,0 +1,38 @@
+#include <catch2/catch.hpp>
+
+#include "MSP430InstructionHelper.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Low power mode Tests", "[LPM]")
+{
+    uint16_t code[] = {
+        0xD032, 0x0010, // 0x00: BIS #CPUOFF, SR (2 cycles)
+        0x5314,         // 0x04: ADD #1, R4
+        0x3FFF,         // 0x06: JMP $
+    };
+
+    sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+    sim.testSetRegister(4, 0);
+
+    SECTION("CPU off skips time without fetching")
+    {
+        sim.testRunBlocks(1);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x04);
+        REQUIRE(sim.getCycles() == 2);
+
+        sim.testRunBlocks(3);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x04);
+        REQUIRE(sim.testGetRegister(4) == 0);
+        REQUIRE(sim.getCycles() == 2 + 3 * MSP430::IDLE_CYCLES);
+    }
+
+    SECTION("Execution resumes once CPUOFF is cleared")
+    {
+        sim.testRunBlocks(2);
+        sim.testSetRegister(MSP430::REG_IDX_SR, 0);
+        sim.testRunBlocks(1);
+        REQUIRE(sim.testGetRegister(4) == 1);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x06);
+    }
+}
@@ -0,0 +1,46 @@
+#include <catch2/catch.hpp>
+#include <chrono>
+
+#include "MSP430Pacer.h"
+#include "MSP430TestFixture.h"
+
+// Host time, in ms, taken to pace cycles on a 1 MHz CPU
+static double pacedMs(MSP430Pacer &pacer, uint64_t cycles)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    pacer.setCpuFrequency(1000000);
+    pacer.start(0);
+    for (uint64_t now = 0; now <= cycles; now += 100)
+    {
+        pacer.pace(now);
+    }
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+TEST_CASE_METHOD(MSP430TestFixture, "Pacing Tests", "[PACING]")
+{
+    MSP430Pacer pacer;
+
+    SECTION("Max speed never sleeps")
+    {
+        pacer.setMode(PACING_MAX_SPEED);
+        REQUIRE(pacedMs(pacer, 10000000) < 1000);
+    }
+
+    SECTION("Real time runs 50000 cycles in 50 ms")
+    {
+        pacer.setMode(PACING_REAL_TIME);
+        REQUIRE(pacedMs(pacer, 50000) >= 40);
+    }
+
+    SECTION("Scaled time runs 100000 cycles in 25 ms at 4x")
+    {
+        pacer.setMode(PACING_SCALED, 4.0);
+        double ms = pacedMs(pacer, 100000);
+        REQUIRE(ms >= 15);
+        REQUIRE(ms < 100);
+    }
+}
@@ -0,0 +1,110 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+#include "Peripheral.h"
+
+// Records the batches of output changes and the input reads, in order
+class RecordingPeripheral : public Peripheral
+{
+public:
+    std::vector<size_t> batches;
+    std::vector<PinChange> changes;
+    std::vector<int> events;
+
+    void txCb(uint8_t value) override { (void)value; }
+
+    uint8_t rxCb() override
+    {
+        events.push_back(-1);
+        return 0x82;
+    }
+
+    void onPinChanges(const PinChange *newChanges, size_t count) override
+    {
+        batches.push_back(count);
+        events.push_back(count);
+        changes.insert(changes.end(), newChanges, newChanges + count);
+    }
+};
+
+TEST_CASE_METHOD(MSP430TestFixture, "Port Peripherals Tests", "[PERIPHERAL]")
+{
+    DevicesManager &bus = sim.getDevicesManager();
+    RecordingPeripheral peripheral;
+    uint16_t code[] = {
+        0x44C2, 0x0019, // 0x00: MOV.B R4, &P3OUT
+        0x5324,         // 0x04: ADD #2, R4
+        0x3FFC,         // 0x06: JMP 0x00
+    };
+
+    sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+    sim.testSetRegister(4, 2);
+    bus.writeByte(0x10, 0xFF); // P3REN
+    bus.writeByte(0x1A, 0xFF); // P3DIR, outputs are read back with bit 0 set
+    bus.attachPeripheral(3, &peripheral);
+
+    SECTION("Changes are batched and stamped with their cycle")
+    {
+        REQUIRE(sim.step(30) == MSP430::STOP_INSTRUCTIONS);
+        REQUIRE(peripheral.batches.size() == 1);
+        REQUIRE(peripheral.changes.size() == 10);
+
+        uint64_t period = peripheral.changes[1].cycle -
+                          peripheral.changes[0].cycle;
+        REQUIRE(period > 0);
+        for (size_t i = 0; i < peripheral.changes.size(); i++)
+        {
+            REQUIRE(peripheral.changes[i].value == 2 * i + 3);
+            REQUIRE(peripheral.changes[i].cycle ==
+                    peripheral.changes[0].cycle + i * period);
+        }
+        REQUIRE(peripheral.changes.back().cycle <= sim.getCycles());
+    }
+
+    SECTION("A full buffer is delivered before the run returns")
+    {
+        REQUIRE(sim.step(300) == MSP430::STOP_INSTRUCTIONS);
+        REQUIRE(peripheral.batches == std::vector<size_t>{64, 36});
+        REQUIRE(peripheral.changes.size() == 100);
+        REQUIRE(peripheral.changes.back().value == 201);
+    }
+
+    SECTION("Changes are delivered before the inputs are read")
+    {
+        bus.writeByte(0x19, 0x12);
+        bus.writeByte(0x19, 0x34);
+        bus.writeByte(0x1A, 0x00);
+        REQUIRE(peripheral.batches.empty());
+
+        // The last output (0x34 with bit 0 set) ORed with the input
+        REQUIRE(bus.readByte(0x18) == 0xB7);
+        REQUIRE(peripheral.events == std::vector<int>{2, -1});
+    }
+
+    SECTION("Unchanged writes are not reported")
+    {
+        bus.writeByte(0x19, 0x05);
+        bus.writeByte(0x19, 0x05);
+        bus.writeByte(0x19, 0x05);
+        bus.flushPinChanges();
+        REQUIRE(peripheral.changes.size() == 1);
+        REQUIRE(peripheral.changes[0].value == 0x05);
+
+        bus.flushPinChanges();
+        REQUIRE(peripheral.batches.size() == 1);
+    }
+
+    SECTION("Callbacks registered as functions see every change")
+    {
+        std::vector<uint8_t> outputs;
+
+        bus.registerPeripheral(
+            3, [] { return uint8_t(0); },
+            [&outputs](uint8_t value) { outputs.push_back(value); });
+        REQUIRE(sim.step(15) == MSP430::STOP_INSTRUCTIONS);
+        REQUIRE(outputs == std::vector<uint8_t>{3, 5, 7, 9, 11});
+        REQUIRE(peripheral.changes.size() == 5);
+    }
+}
@@ -0,0 +1,87 @@
+#include <catch2/catch.hpp>
+
+#include "MSP430InstructionHelper.h"
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Repeated instruction Tests", "[RPT]")
+{
+    SECTION("RPT #n repeats a register instruction n times")
+    {
+        uint16_t code[] = {
+            0x1843, 0x5505, // 0x00: RPT #4 RLAX R5 (2 + 3 cycles)
+            0x3FFF,         // 0x04: JMP $ (2 cycles)
+        };
+
+        sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+        sim.testSetRegister(5, 1);
+        sim.testRunBlocks(1);
+
+        REQUIRE(sim.testGetRegister(5) == 16);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x04);
+        REQUIRE(sim.getCycles() == 7);
+    }
+
+    SECTION("RPT Rn takes the count from a register")
+    {
+        uint16_t code[] = {
+            0x18C6, 0x5505, // 0x00: RPT R6 RLAX R5
+            0x3FFF,         // 0x04: JMP $
+        };
+
+        sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+        sim.testSetRegister(5, 1);
+        sim.testSetRegister(6, 2);
+        sim.testRunBlocks(1);
+
+        REQUIRE(sim.testGetRegister(5) == 8);
+    }
+
+    SECTION("RRCX rotates through the carry")
+    {
+        uint16_t code[] = {
+            0x1841, 0x1005, // 0x00: RPT #2 RRCX R5 (2 + 1 cycles)
+            0x3FFF,         // 0x04: JMP $ (2 cycles)
+        };
+
+        sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+        sim.testSetRegister(5, 0x8001);
+        sim.testSetRegister(MSP430::REG_IDX_SR, 1);
+        sim.testRunBlocks(1);
+
+        REQUIRE(sim.testGetRegister(5) == 0xE000);
+        REQUIRE((sim.testGetRegister(MSP430::REG_IDX_SR) & 1) == 0);
+        REQUIRE(sim.getCycles() == 5);
+    }
+
+    SECTION("ZC clears the carry before each repetition")
+    {
+        uint16_t code[] = {
+            0x1941, 0x1005, // 0x00: RPT #2 RRUX R5
+            0x3FFF,         // 0x04: JMP $
+        };
+
+        sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+        sim.testSetRegister(5, 0x8002);
+        sim.testSetRegister(MSP430::REG_IDX_SR, 1);
+        sim.testRunBlocks(1);
+
+        REQUIRE(sim.testGetRegister(5) == 0x2000);
+        REQUIRE((sim.testGetRegister(MSP430::REG_IDX_SR) & 1) == 1);
+    }
+
+    SECTION("RRAX keeps the sign")
+    {
+        uint16_t code[] = {
+            0x1841, 0x1105, // 0x00: RPT #2 RRAX R5 (2 + 1 cycles)
+            0x3FFF,         // 0x04: JMP $ (2 cycles)
+        };
+
+        sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+        sim.testSetRegister(5, 0x8000);
+        sim.testRunBlocks(1);
+
+        REQUIRE(sim.testGetRegister(5) == 0xE000);
+        REQUIRE(sim.getCycles() == 5);
+    }
+}
@@ -0,0 +1,144 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+#include "ReverseDebugger.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Reverse debugger Tests", "[REVERSE]")
+{
+    // Counter stored to memory at each loop
+    uint16_t code[] = {
+        0x4304,         // 0x00: MOV #0, R4
+        0x5314,         // 0x02: ADD #1, R4
+        0x4482, 0x2000, // 0x04: MOV R4, &0x2000
+        0x3FFC,         // 0x08: JMP 0x02
+    };
+    DevicesManager &bus = sim.getDevicesManager();
+    ReverseDebugger debugger(sim, 50);
+    struct State
+    {
+        uint32_t pc;
+        uint32_t r4;
+        uint64_t cycles;
+    };
+    std::vector<State> states;
+
+    sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+    bus.writeWord(0x2000, 0);
+    REQUIRE(debugger.start());
+
+    // Forward run, one instruction at a time
+    for (int i = 0; i <= 300; i++)
+    {
+        states.push_back({sim.testGetRegister(MSP430::REG_IDX_PC),
+                          sim.testGetRegister(4), sim.getCycles()});
+        if (i < 300)
+        {
+            debugger.step();
+        }
+    }
+    REQUIRE(debugger.getPosition() == 300);
+
+    SECTION("Seeking gives back the exact state")
+    {
+        for (uint64_t position : {299, 150, 151, 3, 0, 200})
+        {
+            REQUIRE(debugger.seek(position));
+            REQUIRE(debugger.getPosition() == position);
+            REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) ==
+                    states[position].pc);
+            REQUIRE(sim.testGetRegister(4) == states[position].r4);
+            REQUIRE(sim.getCycles() == states[position].cycles);
+        }
+
+        // Running forward from the past follows the same execution
+        debugger.step(100);
+        REQUIRE(debugger.getPosition() == 300);
+        REQUIRE(sim.testGetRegister(4) == states[300].r4);
+        REQUIRE(sim.getCycles() == states[300].cycles);
+    }
+
+    SECTION("Reverse steps stop at the session start")
+    {
+        REQUIRE(debugger.reverseStep(10));
+        REQUIRE(debugger.getPosition() == 290);
+        REQUIRE(sim.testGetRegister(4) == states[290].r4);
+
+        REQUIRE_FALSE(debugger.reverseStep(1000));
+        REQUIRE(debugger.getPosition() == 0);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0);
+    }
+
+    SECTION("Reverse continue stops at the last breakpoint")
+    {
+        sim.addBreakpoint(0x00);
+        REQUIRE(debugger.reverseContinue());
+        REQUIRE(debugger.getPosition() == 0);
+
+        debugger.seek(300);
+        sim.clearBreakpoints();
+        sim.addBreakpoint(0x08);
+        REQUIRE(debugger.reverseContinue());
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x08);
+        REQUIRE(debugger.getPosition() > 290);
+        REQUIRE(sim.testGetRegister(4) ==
+                states[debugger.getPosition()].r4);
+
+        // From a breakpoint, the previous one is found
+        uint64_t last = debugger.getPosition();
+        REQUIRE(debugger.reverseContinue());
+        REQUIRE(debugger.getPosition() == last - 3);
+
+        sim.clearBreakpoints();
+        REQUIRE_FALSE(debugger.reverseContinue());
+        REQUIRE(debugger.getPosition() == 0);
+    }
+
+    SECTION("Run back to the last write of an address")
+    {
+        uint16_t value = bus.readWord(0x2000);
+
+        REQUIRE(debugger.runBackToWrite(0x2000));
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x04);
+        REQUIRE(bus.readWord(0x2000) == value - 1);
+
+        // Stepping the writing instruction gives the value back
+        debugger.step();
+        REQUIRE(bus.readWord(0x2000) == value);
+
+        REQUIRE_FALSE(debugger.runBackToWrite(0x2100));
+        REQUIRE(debugger.getPosition() == 0);
+    }
+
+    SECTION("Inputs recorded by a forward seek are replayed")
+    {
+        uint8_t input = 0x12;
+
+        bus.registerPeripheral(5, [&input] { return input; },
+                               [](uint8_t) {});
+
+        // Past the furthest point run, the input is recorded. P5REN is
+        // set again after each seek, which restores the port.
+        REQUIRE(debugger.seek(400));
+        bus.writeByte(0x12, 0xFF);
+        REQUIRE(bus.readByte(0x30) == 0x12); // P5IN
+        REQUIRE(debugger.seek(450));
+
+        REQUIRE(debugger.seek(350));
+        REQUIRE(debugger.seek(400));
+        bus.writeByte(0x12, 0xFF);
+        input = 0x34;
+        REQUIRE(bus.readByte(0x30) == 0x12);
+    }
+
+    SECTION("Watchpoints stop forward runs after the write")
+    {
+        debugger.seek(0);
+        sim.addWatchpoint(0x2000);
+        REQUIRE(debugger.runFor(1000) == MSP430::STOP_WATCHPOINT);
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x08);
+        REQUIRE(bus.readWord(0x2000) == 1);
+        sim.removeWatchpoint(0x2000);
+    }
+}
@@ -0,0 +1,98 @@
+#include <catch2/catch.hpp>
+#include <stdio.h>
+#include <vector>
+
+#include "MSP430TestFixture.h"
+#include "MSP430TestHelper.h"
+
+TEST_CASE_METHOD(MSP430TestFixture, "Snapshot Tests", "[SNAPSHOT]")
+{
+    // R5 = 2 * R4 computed by a loop
+    uint16_t code[] = {
+        0x4034, 0x0003, // 0x00: MOV #3, R4
+        0x4305,         // 0x04: MOV #0, R5
+        0x5325,         // 0x06: ADD #2, R5
+        0x8314,         // 0x08: SUB #1, R4
+        0x23FD,         // 0x0A: JNZ 0x06
+        0x3FFF,         // 0x0C: JMP $
+    };
+    std::vector<uint8_t> snapshot;
+
+    sim.testLoadCode(code, sizeof(code) / sizeof(code[0]));
+
+    SECTION("Restore brings back the CPU, memory and devices")
+    {
+        DevicesManager &bus = sim.getDevicesManager();
+
+        sim.step(4);
+        bus.writeWord(0x2000, 0x1234);
+        bus.writeWord(0x0120, 0x5A80); // WDTCTL
+        REQUIRE(sim.saveSnapshot(snapshot));
+
+        sim.runUntil(0x0C);
+        bus.writeWord(0x2000, 0);
+        bus.writeWord(0x0120, 0x5A00);
+        REQUIRE(sim.restoreSnapshot(snapshot));
+
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x0A);
+        REQUIRE(sim.testGetRegister(4) == 2);
+        REQUIRE(sim.getCycles() == 5);
+        REQUIRE(sim.getExecutedInstructions() == 4);
+        REQUIRE(bus.readWord(0x2000) == 0x1234);
+        REQUIRE(bus.readWord(0x0120) == 0x5A80);
+
+        REQUIRE(sim.runUntil(0x0C) == MSP430::STOP_TARGET_PC);
+        REQUIRE(sim.testGetRegister(5) == 6);
+    }
+
+    SECTION("Code changed by a restore is decoded again")
+    {
+        uint16_t other[] = {0x4034, 0x0007}; // 0x00: MOV #7, R4
+
+        REQUIRE(sim.saveSnapshot(snapshot));
+        sim.testLoadCode(other, 2);
+        sim.step();
+        REQUIRE(sim.testGetRegister(4) == 7);
+
+        REQUIRE(sim.restoreSnapshot(snapshot));
+        sim.step();
+        REQUIRE(sim.testGetRegister(4) == 3);
+    }
+
+    SECTION("Invalid snapshots are rejected")
+    {
+        DevicesManager &bus = sim.getDevicesManager();
+
+        REQUIRE(sim.saveSnapshot(snapshot));
+        sim.step();
+        bus.writeWord(0x2000, 0x1234);
+
+        std::vector<uint8_t> truncated(snapshot.begin(),
+                                       snapshot.end() - 1);
+        REQUIRE_FALSE(sim.restoreSnapshot(truncated));
+
+        // Nothing is restored from a snapshot failing past the memory
+        std::vector<uint8_t> trailing(snapshot);
+        trailing.push_back(0);
+        REQUIRE_FALSE(sim.restoreSnapshot(trailing));
+        REQUIRE(bus.readWord(0x2000) == 0x1234);
+
+        snapshot[4]++; // version
+        REQUIRE_FALSE(sim.restoreSnapshot(snapshot));
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x04);
+    }
+
+    SECTION("Snapshots can be saved to a file")
+    {
+        const char *filename = "snapshot_test.bin";
+
+        sim.step(2);
+        REQUIRE(sim.saveSnapshotFile(filename));
+        sim.step(3);
+        REQUIRE(sim.restoreSnapshotFile(filename));
+        REQUIRE(sim.testGetRegister(MSP430::REG_IDX_PC) == 0x06);
+        remove(filename);
+
+        REQUIRE_FALSE(sim.restoreSnapshotFile(filename));
+    }
+}
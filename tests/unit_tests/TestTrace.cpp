@@ -0,0 +1,95 @@
+#include <catch2/catch.hpp>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MSP430TestFixture.h"
+#include "MSP430Trace.h"
+
+// Flushes the trace sink and returns what has been written to output
+static std::string readOutput(FILE *output)
+{
+    char line[128];
+    std::string content;
+
+    MSP430Trace::flush();
+    rewind(output);
+    while (fgets(line, sizeof(line), output) != nullptr)
+    {
+        content += line;
+    }
+    return content;
+}
+
+TEST_CASE_METHOD(MSP430TestFixture, "Trace Tests", "[TRACE]")
+{
+    FILE *output = tmpfile();
+    REQUIRE(output != nullptr);
+    MSP430Trace::setOutput(output);
+
+    SECTION("Messages are buffered until flushed")
+    {
+        MSP430Trace::write(TRACE_PORT, "write %s = %X\n", "P1", 0x90);
+        REQUIRE(ftell(output) == 0);
+        REQUIRE(readOutput(output) == "[port] write P1 = 90\n");
+    }
+
+    SECTION("Muted categories are not traced")
+    {
+        MSP430Trace::setEnabled(TRACE_BUS, false);
+        MSP430_TRACE(TRACE_LEVEL_NONE, TRACE_BUS, "muted\n");
+        MSP430_TRACE(TRACE_LEVEL_NONE, TRACE_CPU, "traced\n");
+        MSP430Trace::setEnabled(TRACE_BUS, true);
+        REQUIRE(readOutput(output) == "[cpu] traced\n");
+    }
+
+    SECTION("Messages of concurrent threads are not interleaved")
+    {
+        std::vector<std::thread> threads;
+
+        for (int thread = 0; thread < 4; thread++)
+        {
+            threads.emplace_back(
+                [thread]
+                {
+                    for (int i = 0; i < 1000; i++)
+                    {
+                        MSP430Trace::write(TRACE_CPU, "thread %d\n", thread);
+                    }
+                });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        std::string content = readOutput(output);
+        size_t lines = 0;
+        for (size_t start = 0; start < content.size(); lines++)
+        {
+            size_t end = content.find('\n', start);
+            std::string line = content.substr(start, end - start);
+
+            REQUIRE(line.size() == 14);
+            REQUIRE(line.compare(0, 13, "[cpu] thread ") == 0);
+            start = end + 1;
+        }
+        REQUIRE(lines == 4000);
+    }
+
+    SECTION("Levels above MSP430_TRACE_LEVEL are compiled out")
+    {
+        int evaluated = 0;
+
+        if (!MSP430Trace::isCompiled(TRACE_LEVEL_DEBUG))
+        {
+            TRACE_DEBUG(TRACE_CPU, "%d\n", ++evaluated);
+            REQUIRE(evaluated == 0);
+            REQUIRE(readOutput(output).empty());
+        }
+    }
+
+    MSP430Trace::setOutput(nullptr);
+    fclose(output);
+}